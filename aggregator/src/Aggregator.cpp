@@ -0,0 +1,258 @@
+#include "Aggregator.h"
+#include "WireDecoder.h"
+
+#define ALIGN_WINDOW_MICROS 10000000 // how long a clock offset minimum is trusted
+
+bool Aggregator::setup(const Settings& _settings) {
+    settings = _settings;
+
+    if (!receiver.setup(settings.port)) {
+        ofLogError("Aggregator") << "can't listen on " << settings.port;
+        return false;
+    }
+    sender.setup(settings.outHost, settings.outPort);
+
+    if (!settings.recordPath.empty()) {
+        if (!recorder.open(settings.recordPath)) {
+            ofLogError("Aggregator") << "can't record to " << settings.recordPath;
+            return false;
+        }
+        recordStart = ofGetElapsedTimeMicros();
+    }
+
+    nodes.reserve(settings.maxNodes);
+    ofLogNotice("Aggregator") << "listening on " << settings.port << ", forwarding to " << settings.outHost << ":" << settings.outPort;
+    return true;
+}
+
+uint64_t Aggregator::hash(const char* data, size_t size, uint64_t seed) {
+    // FNV-1a
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= uint8_t(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool Aggregator::isPerItem(const ofxOscMessage& message) {
+    size_t numArgs = message.getNumArgs();
+    if (numArgs < 3 || message.getArgType(0) != OFXOSC_TYPE_STRING || message.getArgType(1) != OFXOSC_TYPE_STRING) return false;
+    ofxOscArgType last = message.getArgType(numArgs - 1);
+    return last == OFXOSC_TYPE_INT32 || last == OFXOSC_TYPE_INT64;
+}
+
+void Aggregator::update() {
+    uint64_t now = ofGetElapsedTimeMicros();
+
+    ofxOscMessage message;
+    while (receiver.getNextMessage(message)) receive(message, now);
+
+    if (now - lastTick >= uint64_t(1000000 / max(settings.tickRate, 1))) {
+        lastTick = now;
+        forward(now);
+    }
+}
+
+// ~ ~ ~ INPUT ~ ~ ~
+int Aggregator::findNode(const string& key, uint64_t now) {
+    auto found = nodeIndex.find(key);
+    if (found != nodeIndex.end()) {
+        nodes[found->second]->lastSeen = now;
+        return found->second;
+    }
+
+    int index = -1;
+    if (nodes.size() < size_t(settings.maxNodes)) {
+        nodes.emplace_back(new Node());
+        index = nodes.size() - 1;
+    } else {
+        // reuse the longest silent node that has nothing waiting
+        for (int i = 0; i < nodes.size(); i++) {
+            if (nodes[i]->pending.empty() && (index < 0 || nodes[i]->lastSeen < nodes[index]->lastSeen)) index = i;
+        }
+        if (index < 0) return -1;
+        nodeIndex.erase(nodes[index]->key);
+        nodes[index].reset(new Node());
+    }
+
+    nodes[index]->key = key;
+    nodes[index]->lastSeen = now;
+    nodeIndex[key] = index;
+    stats.nodes = nodeIndex.size();
+    ofLogNotice("Aggregator") << "new node " << key;
+    return index;
+}
+
+bool Aggregator::isDuplicate(Node& node, uint64_t key) {
+    if (!node.seen.insert(key).second) return true;
+    node.seenOrder.push_back(key);
+    if (node.seenOrder.size() > size_t(settings.dedupeWindow)) {
+        node.seen.erase(node.seenOrder.front());
+        node.seenOrder.pop_front();
+    }
+    return false;
+}
+
+int64_t Aggregator::align(Node& node, int64_t timestampMillis, uint64_t now) {
+    int64_t sample = int64_t(now) - timestampMillis * 1000;
+    if (!node.hasOffset) {
+        node.windowMin = node.previousMin = sample;
+        node.windowStart = now;
+        node.hasOffset = true;
+    }
+
+    // a minimum over two windows follows clock drift without jumping at the window edge
+    if (now - node.windowStart > ALIGN_WINDOW_MICROS) {
+        node.previousMin = node.windowMin;
+        node.windowMin = sample;
+        node.windowStart = now;
+    }
+    node.windowMin = min(node.windowMin, sample);
+    node.offset = min(node.windowMin, node.previousMin);
+    return timestampMillis * 1000 + node.offset;
+}
+
+void Aggregator::receive(ofxOscMessage& message, uint64_t now) {
+    stats.received++;
+    if (recorder.isOpen()) recorder.write(now - recordStart, message);
+
+    const string& address = message.getAddress();
+    if (address == "/stats") {
+        sender.sendMessage(message, false);
+        stats.forwarded++;
+        return;
+    }
+
+    // which node, from hostname and unique_id
+    string key;
+    if (message.getNumArgs() >= 2 && message.getArgType(0) == OFXOSC_TYPE_STRING && message.getArgType(1) == OFXOSC_TYPE_STRING) {
+        key = message.getArgAsString(0) + "/" + message.getArgAsString(1);
+    } else {
+        key = message.getRemoteHost();
+    }
+    int index = findNode(key, now);
+    if (index < 0) {
+        stats.overflowed++;
+        return;
+    }
+    Node& node = *nodes[index];
+
+    // which frame, for the batched and compact formats; per-item messages only have a timestamp
+    bool framed = false;
+    bool timed = false;
+    uint64_t seq = 0;
+    int64_t timestamp = 0;
+    int part = 0;
+    int type = 0;
+    size_t numArgs = message.getNumArgs();
+    if ((address == "/blobs" || address == "/contours" || address == "/pixels") && numArgs >= 7 && message.getArgType(2) == OFXOSC_TYPE_INT64) {
+        seq = message.getArgAsInt64(2);
+        timestamp = message.getArgAsInt32(3);
+        part = message.getArgAsInt32(5);
+        framed = true;
+    } else if (address == "/wire" && numArgs >= 3 && message.getArgType(2) == OFXOSC_TYPE_BLOB) {
+        ofBuffer blob = message.getArgAsBlob(2);
+        WireReader in(reinterpret_cast<const uint8_t*>(blob.getData()), blob.size());
+        if (in.byte() == 'P' && in.byte() == 'W' && in.byte() == 1) { // magic and version
+            type = in.byte();
+            in.byte(); // fracBits
+            seq = in.varint();
+            timestamp = in.svarint();
+            in.varint(); // total
+            part = in.varint();
+            framed = in.ok();
+        }
+    } else if (isPerItem(message)) {
+        size_t last = numArgs - 1;
+        timestamp = message.getArgType(last) == OFXOSC_TYPE_INT64 ? message.getArgAsInt64(last) : message.getArgAsInt32(last);
+        timed = true;
+    }
+
+    // a frame's part is only sent once, anything else (per-item messages included, whose
+    // content carries the timestamp) is compared by content
+    scratch.clear();
+    if (framed) {
+        scratch = address;
+        scratch.append(reinterpret_cast<const char*>(&type), sizeof type);
+        scratch.append(reinterpret_cast<const char*>(&seq), sizeof seq);
+        scratch.append(reinterpret_cast<const char*>(&part), sizeof part);
+    } else {
+        OscRecording::serialize(message, scratch);
+    }
+    if (isDuplicate(node, hash(scratch.data(), scratch.size()))) {
+        stats.duplicates++;
+        return;
+    }
+
+    if (node.pending.size() >= size_t(settings.maxPendingPerNode)) {
+        node.pending.pop_front();
+        stats.overflowed++;
+    }
+    node.pending.emplace_back();
+    Pending& pending = node.pending.back();
+    pending.message = message;
+    pending.alignedMicros = framed || timed ? align(node, timestamp, now) : int64_t(now);
+    pending.arrivalMicros = now;
+    pending.seq = seq;
+    pending.part = part;
+    pending.node = index;
+}
+
+// ~ ~ ~ OUTPUT ~ ~ ~
+void Aggregator::forward(uint64_t now) {
+    int64_t cutoff = int64_t(now) - int64_t(settings.alignDelay) * 1000;
+
+    tick.clear();
+    int pending = 0;
+    uint64_t nodesInFrame = 0;
+    for (auto& node : nodes) {
+        bool contributed = false;
+        while (!node->pending.empty() && node->pending.front().alignedMicros <= cutoff) {
+            tick.push_back(std::move(node->pending.front()));
+            node->pending.pop_front();
+            contributed = true;
+        }
+        if (contributed) nodesInFrame++;
+        pending += node->pending.size();
+    }
+    stats.pending = pending;
+    if (tick.empty()) return;
+
+    std::sort(tick.begin(), tick.end(), [](const Pending& a, const Pending& b) {
+        if (a.alignedMicros != b.alignedMicros) return a.alignedMicros < b.alignedMicros;
+        if (a.node != b.node) return a.node < b.node;
+        if (a.seq != b.seq) return a.seq < b.seq;
+        return a.part < b.part;
+    });
+
+    frameSeq++;
+    ofxOscMessage header;
+    header.setAddress("/agg/frame");
+    header.addInt64Arg(frameSeq);
+    header.addInt64Arg(tick.front().alignedMicros / 1000);
+    header.addIntArg(nodesInFrame);
+    header.addIntArg(tick.size());
+    sender.sendMessage(header, false);
+
+    for (auto& pending : tick) {
+        sender.sendMessage(pending.message, false);
+        stats.alignLatencyMillis = ofLerp(stats.alignLatencyMillis, (now - pending.arrivalMicros) / 1000.0f, 0.01f);
+    }
+
+    ofxOscMessage footer;
+    footer.setAddress("/agg/end");
+    footer.addInt64Arg(frameSeq);
+    sender.sendMessage(footer, false);
+
+    stats.forwarded += tick.size();
+    stats.frames++;
+}
+
+string Aggregator::getStatsLine() const {
+    stringstream line;
+    line << stats.nodes << " nodes, received " << stats.received << ", duplicates " << stats.duplicates << ", overflowed " << stats.overflowed
+         << ", forwarded " << stats.forwarded << " in " << stats.frames << " frames, pending " << stats.pending
+         << ", latency " << int(stats.alignLatencyMillis) << "ms";
+    return line.str();
+}
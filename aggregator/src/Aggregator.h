@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "OscRecording.h"
+
+// Merges the OSC output of many Pinopticam nodes into one stream. Every node sends its
+// usual messages to the aggregator's port; messages are keyed to a node by their
+// hostname and unique_id arguments (or the sender's address), duplicates are dropped,
+// and what's left is put on a common clock and forwarded to one host and port.
+//
+// Node clocks aren't synchronized, so each node's frame timestamps are mapped onto the
+// aggregator's clock with the smallest arrival - timestamp difference seen recently, i.e.
+// the least delayed packet. Every tick, messages whose mapped time is older than
+// alignDelay go out, sorted by time, node, seq and part, between an /agg/frame header and
+// an /agg/end footer, so a consumer sees one frame of every node together:
+//
+//   /agg/frame  frame (int64), time in ms (int64), nodes, messages
+//   ...the node messages, unchanged...
+//   /agg/end    frame (int64)
+//
+// /stats messages skip the alignment and are forwarded as they come. Memory is bounded:
+// at most maxPendingPerNode messages wait per node and maxNodes nodes are tracked, the
+// oldest waiting message (or the longest silent node) makes room.
+class Aggregator {
+
+    public:
+        struct Settings {
+            int port = 7110; // where the nodes send
+            string outHost = "localhost";
+            int outPort = 7120;
+            int tickRate = 30; // merged frames per second
+            int alignDelay = 50; // ms to wait for stragglers before a message goes out
+            int maxPendingPerNode = 2000;
+            int maxNodes = 256;
+            int dedupeWindow = 4096; // recent message keys remembered per node
+            string recordPath; // record everything received, for the node simulator; empty for off
+        };
+
+        struct Stats {
+            uint64_t received = 0;
+            uint64_t duplicates = 0;
+            uint64_t overflowed = 0; // dropped to stay within the memory bounds
+            uint64_t forwarded = 0;
+            uint64_t frames = 0;
+            int nodes = 0;
+            int pending = 0;
+            float alignLatencyMillis = 0; // arrival to forward, running average
+        };
+
+        bool setup(const Settings& settings);
+
+        // call often: drains the socket, and forwards a merged frame when a tick is due
+        void update();
+
+        const Stats& getStats() const { return stats; }
+        string getStatsLine() const;
+
+        // the per-item messages (one blob, contour or pixel each) end with their frame's timestamp
+        static bool isPerItem(const ofxOscMessage& message);
+
+    protected:
+        struct Pending {
+            ofxOscMessage message;
+            int64_t alignedMicros; // on the aggregator's clock
+            uint64_t arrivalMicros;
+            uint64_t seq;
+            int part;
+            int node;
+        };
+
+        struct Node {
+            string key; // hostname + unique_id
+            uint64_t lastSeen = 0;
+            std::deque<Pending> pending;
+
+            // clock offset in micros, the minimum over the current and previous window
+            int64_t offset = 0, windowMin = 0, previousMin = 0;
+            uint64_t windowStart = 0;
+            bool hasOffset = false;
+
+            // dedupe: a set of recent keys plus their arrival order, for eviction
+            std::unordered_set<uint64_t> seen;
+            std::deque<uint64_t> seenOrder;
+        };
+
+        void receive(ofxOscMessage& message, uint64_t now);
+        void forward(uint64_t now);
+        int findNode(const string& key, uint64_t now);
+        bool isDuplicate(Node& node, uint64_t key);
+        int64_t align(Node& node, int64_t timestampMillis, uint64_t now);
+        static uint64_t hash(const char* data, size_t size, uint64_t seed = 1469598103934665603ULL);
+
+        Settings settings;
+        ofxOscReceiver receiver;
+        ofxOscSender sender;
+        OscRecording::Writer recorder;
+        uint64_t recordStart = 0;
+
+        vector<unique_ptr<Node>> nodes;
+        std::unordered_map<string, int> nodeIndex;
+        uint64_t lastTick = 0;
+        uint64_t frameSeq = 0;
+        Stats stats;
+
+        // reused every message / tick
+        string scratch;
+        vector<Pending> tick;
+
+};
@@ -0,0 +1,27 @@
+#include "AggregatorApp.h"
+
+#define AGGREGATOR_STATS_INTERVAL 1.0f // seconds
+#define AGGREGATOR_LOOP_RATE 1000 // updates per second, so neither side waits on the loop
+
+void AggregatorApp::setup() {
+    ofSetFrameRate(AGGREGATOR_LOOP_RATE);
+
+    bool ok = options.simulate ? simulator.setup(options.simulator) : aggregator.setup(options.aggregator);
+    if (!ok) ofExit(1);
+}
+
+void AggregatorApp::update() {
+    if (options.simulate) {
+        simulator.update();
+    } else {
+        aggregator.update();
+    }
+
+    float now = ofGetElapsedTimef();
+    if (now - lastStatsTime >= AGGREGATOR_STATS_INTERVAL) {
+        lastStatsTime = now;
+        cout << (options.simulate ? simulator.getStatsLine() : aggregator.getStatsLine()) << endl;
+    }
+
+    if (options.seconds > 0 && now >= options.seconds) ofExit(0);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Aggregator.h"
+#include "NodeSimulator.h"
+
+// Runs either the aggregator or the node simulator, without a window, and prints a
+// stats line once a second.
+class AggregatorApp : public ofBaseApp {
+
+    public:
+        struct Options {
+            bool simulate = false;
+            float seconds = 0; // stop after this long, 0 to run until killed
+            Aggregator::Settings aggregator;
+            NodeSimulator::Settings simulator;
+        };
+
+        AggregatorApp(const Options& options) : options(options) { }
+
+        void setup() override;
+        void update() override;
+
+    protected:
+        Options options;
+        Aggregator aggregator;
+        NodeSimulator simulator;
+        float lastStatsTime = 0;
+
+};
@@ -0,0 +1,4 @@
+// The app's modules the aggregator shares, compiled from ../src so the node simulator
+// writes packets exactly the way the nodes do.
+
+#include "../../src/WireFormat.cpp"
@@ -0,0 +1,244 @@
+#include "NodeSimulator.h"
+#include "Aggregator.h"
+#include "WireFormat.h"
+#include "WireDecoder.h"
+
+#define SIM_MAX_PACKET_SIZE 1400 // as max_packet_size on the nodes
+#define SIM_POINTS_PER_CONTOUR 24
+#define SIM_CLOCK_SPREAD 60000 // ms, how far apart the nodes' clocks start
+
+// seq, timestamp and part of a compact /wire packet, and where the fields after the timestamp start
+static bool readWireHeader(const ofBuffer& blob, uint64_t& seq, int64_t& timestamp, int& part, size_t& restOffset) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(blob.getData());
+    WireReader in(data, blob.size());
+    if (in.byte() != 'P' || in.byte() != 'W' || in.byte() != WireEncoder::VERSION) return false;
+    in.byte(); // type
+    in.byte(); // fracBits
+    seq = in.varint();
+    timestamp = in.svarint();
+    restOffset = in.position() - data;
+    in.varint(); // total
+    part = in.varint();
+    return in.ok();
+}
+
+bool NodeSimulator::setup(const Settings& _settings) {
+    settings = _settings;
+    settings.frameRate = max(settings.frameRate, 1);
+    sender.setup(settings.host, settings.port);
+
+    if (!settings.recordingPath.empty()) {
+        OscRecording::Reader reader;
+        if (!reader.open(settings.recordingPath)) {
+            ofLogError("NodeSimulator") << "can't read " << settings.recordingPath;
+            return false;
+        }
+        uint64_t micros;
+        ofxOscMessage message;
+        uint64_t minSeq = UINT64_MAX, maxSeq = 0;
+        while (reader.read(micros, message)) {
+            if (message.getAddress() == "/stats") continue;
+            uint64_t seq = 0;
+            int64_t timestamp = 0;
+            int part = 0;
+            size_t restOffset = 0;
+            bool hasSeq = false;
+            if (message.getNumArgs() >= 3 && message.getArgType(2) == OFXOSC_TYPE_INT64) {
+                seq = message.getArgAsInt64(2);
+                hasSeq = true;
+            } else if (message.getAddress() == "/wire" && message.getNumArgs() >= 3 && message.getArgType(2) == OFXOSC_TYPE_BLOB) {
+                hasSeq = readWireHeader(message.getArgAsBlob(2), seq, timestamp, part, restOffset);
+            }
+            if (hasSeq) {
+                minSeq = min(minSeq, seq);
+                maxSeq = max(maxSeq, seq);
+            }
+            recording.emplace_back(micros, message);
+        }
+        if (recording.empty()) {
+            ofLogError("NodeSimulator") << settings.recordingPath << " has nothing to replay";
+            return false;
+        }
+        recordingSpan = recording.back().first - recording.front().first + 1000000 / settings.frameRate;
+        recordingSeqSpan = maxSeq >= minSeq ? maxSeq - minSeq + 1 : 0;
+        ofLogNotice("NodeSimulator") << "replaying " << recording.size() << " messages over " << recordingSpan / 1000 << "ms";
+    }
+
+    start = ofGetElapsedTimeMicros();
+    nodes.resize(settings.numNodes);
+    for (int i = 0; i < nodes.size(); i++) {
+        Node& node = nodes[i];
+        node.hostName = "sim-" + ofToString(i, 2, '0');
+        node.sessionId = ofToString(int(ofRandom(100000, 999999)));
+        node.clockOffset = ofRandom(-SIM_CLOCK_SPREAD, SIM_CLOCK_SPREAD);
+        // spread the nodes over a frame, and over the recording, like unsynchronized cameras
+        node.nextFrame = start + ofRandom(1000000 / settings.frameRate);
+        if (!recording.empty()) {
+            node.next = ofRandom(recording.size());
+            node.loopStart = start - (recording[node.next].first - recording.front().first);
+        }
+    }
+
+    ofLogNotice("NodeSimulator") << nodes.size() << " nodes sending to " << settings.host << ":" << settings.port;
+    return true;
+}
+
+void NodeSimulator::update() {
+    uint64_t now = ofGetElapsedTimeMicros();
+    for (auto& node : nodes) {
+        if (recording.empty()) {
+            generate(node, now);
+        } else {
+            replay(node, now);
+        }
+    }
+}
+
+void NodeSimulator::send(const ofxOscMessage& message) {
+    sender.sendMessage(message, false);
+    messagesSent++;
+    if (settings.duplicateRate > 0 && ofRandomuf() < settings.duplicateRate) {
+        sender.sendMessage(message, false);
+        messagesSent++;
+        duplicatesSent++;
+    }
+}
+
+// ~ ~ ~ GENERATE ~ ~ ~
+void NodeSimulator::generate(Node& node, uint64_t now) {
+    uint64_t interval = 1000000 / settings.frameRate;
+    while (node.nextFrame <= now) {
+        int64_t timestamp = int64_t(node.nextFrame / 1000) + node.clockOffset;
+        if (settings.jitterMillis > 0) timestamp += ofRandom(settings.jitterMillis);
+        int count = settings.messagesPerFrame;
+
+        // blob: index, x, y, radius
+        payload.clear();
+        for (int i = 0; i < count; i++) {
+            float x = ofNoise(i, node.seq * 0.01f) * 640;
+            float y = ofNoise(i + 0.5f, node.seq * 0.01f) * 480;
+            payload.insert(payload.end(), { float(i), x, y, 10.0f });
+        }
+        sendBatch(node, "/blobs", timestamp, count, 4);
+
+        // contour: index, r, g, b, numPoints, then x, y, z per point
+        payload.clear();
+        for (int i = 0; i < count; i++) {
+            payload.insert(payload.end(), { float(i), 255, 255, 255, float(SIM_POINTS_PER_CONTOUR) });
+            for (int j = 0; j < SIM_POINTS_PER_CONTOUR; j++) {
+                float angle = TWO_PI * j / SIM_POINTS_PER_CONTOUR;
+                payload.insert(payload.end(), { 320 + cosf(angle) * (10 + i), 240 + sinf(angle) * (10 + i), 127 });
+            }
+        }
+        sendBatch(node, "/contours", timestamp, count, 5 + SIM_POINTS_PER_CONTOUR * 3);
+
+        node.seq++;
+        node.nextFrame += interval;
+        framesSent++;
+    }
+}
+
+// splits the payload on item boundaries like BatchSender, every item the same size here
+void NodeSimulator::sendBatch(Node& node, const string& address, int64_t timestamp, int count, size_t itemFloats) {
+    size_t itemsPerPart = max<size_t>((SIM_MAX_PACKET_SIZE - 64 - node.hostName.size() - node.sessionId.size()) / (itemFloats * sizeof(float)), 1);
+    int parts = max<int>((count + itemsPerPart - 1) / itemsPerPart, 1);
+
+    for (int part = 0; part < parts; part++) {
+        size_t first = part * itemsPerPart;
+        size_t last = min<size_t>(first + itemsPerPart, count);
+        partBuffer.set(reinterpret_cast<const char*>(payload.data() + first * itemFloats), (last - first) * itemFloats * sizeof(float));
+
+        ofxOscMessage m;
+        m.setAddress(address);
+        m.addStringArg(node.hostName);
+        m.addStringArg(node.sessionId);
+        m.addInt64Arg(node.seq);
+        m.addIntArg(timestamp);
+        m.addIntArg(count);
+        m.addIntArg(part);
+        m.addIntArg(parts);
+        m.addBlobArg(partBuffer);
+        send(m);
+    }
+}
+
+// ~ ~ ~ REPLAY ~ ~ ~
+void NodeSimulator::replay(Node& node, uint64_t now) {
+    uint64_t first = recording.front().first;
+    while (true) {
+        if (node.next >= recording.size()) {
+            node.next = 0;
+            node.loopStart += recordingSpan;
+            node.loops++;
+        }
+        auto& record = recording[node.next];
+        if (node.loopStart + (record.first - first) > now) break;
+        node.next++;
+
+        // same message as this node, with seq and timestamp moved on by the loops played,
+        // so the aggregator can tell the nodes and the loops apart
+        const ofxOscMessage& in = record.second;
+        int64_t timeShift = node.clockOffset + int64_t(node.loops * recordingSpan / 1000);
+        if (settings.jitterMillis > 0) timeShift += ofRandom(settings.jitterMillis);
+        uint64_t seqShift = node.loops * recordingSeqSpan;
+
+        bool batched = in.getNumArgs() >= 7 && in.getArgType(2) == OFXOSC_TYPE_INT64;
+        bool wire = false;
+        uint64_t seq = 0;
+        int64_t timestamp = 0;
+        int part = 0;
+        size_t restOffset = 0;
+        if (!batched && in.getAddress() == "/wire" && in.getNumArgs() >= 3 && in.getArgType(2) == OFXOSC_TYPE_BLOB) {
+            wire = readWireHeader(in.getArgAsBlob(2), seq, timestamp, part, restOffset);
+        }
+        bool perItem = !batched && !wire && Aggregator::isPerItem(in);
+        size_t last = in.getNumArgs() - 1;
+
+        ofxOscMessage out;
+        out.setAddress(in.getAddress());
+        for (size_t i = 0; i < in.getNumArgs(); i++) {
+            if (i < 2 && in.getArgType(i) == OFXOSC_TYPE_STRING) {
+                out.addStringArg(i == 0 ? node.hostName : node.sessionId);
+            } else if (batched && i == 2) {
+                out.addInt64Arg(in.getArgAsInt64(i) + seqShift);
+            } else if (batched && i == 3) {
+                out.addIntArg(in.getArgAsInt32(i) + timeShift);
+            } else if (wire && i == 2) {
+                // the header up to seq, the new seq and timestamp, then everything after as it was
+                ofBuffer blob = in.getArgAsBlob(i);
+                const uint8_t* data = reinterpret_cast<const uint8_t*>(blob.getData());
+                wirePacket.assign(data, data + 5); // magic, version, type, fracBits
+                WireEncoder::putVarint(wirePacket, seq + seqShift);
+                WireEncoder::putSvarint(wirePacket, timestamp + timeShift);
+                wirePacket.insert(wirePacket.end(), data + restOffset, data + blob.size());
+                partBuffer.set(reinterpret_cast<const char*>(wirePacket.data()), wirePacket.size());
+                out.addBlobArg(partBuffer);
+            } else if (perItem && i == last) {
+                if (in.getArgType(i) == OFXOSC_TYPE_INT64) out.addInt64Arg(in.getArgAsInt64(i) + timeShift);
+                else out.addIntArg(in.getArgAsInt32(i) + timeShift);
+            } else {
+                switch (in.getArgType(i)) {
+                    case OFXOSC_TYPE_INT32: out.addIntArg(in.getArgAsInt32(i)); break;
+                    case OFXOSC_TYPE_INT64: out.addInt64Arg(in.getArgAsInt64(i)); break;
+                    case OFXOSC_TYPE_FLOAT: out.addFloatArg(in.getArgAsFloat(i)); break;
+                    case OFXOSC_TYPE_DOUBLE: out.addDoubleArg(in.getArgAsDouble(i)); break;
+                    case OFXOSC_TYPE_STRING: out.addStringArg(in.getArgAsString(i)); break;
+                    case OFXOSC_TYPE_BLOB: out.addBlobArg(in.getArgAsBlob(i)); break;
+                    case OFXOSC_TYPE_TRUE: out.addBoolArg(true); break;
+                    case OFXOSC_TYPE_FALSE: out.addBoolArg(false); break;
+                    default: break;
+                }
+            }
+        }
+        send(out);
+        if ((batched && in.getArgAsInt32(5) == 0) || (wire && part == 0)) framesSent++; // first part
+    }
+}
+
+string NodeSimulator::getStatsLine() const {
+    stringstream line;
+    float seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0f;
+    line << nodes.size() << " nodes, sent " << messagesSent << " (" << int(messagesSent / max(seconds, 1.0f)) << "/s), "
+         << duplicatesSent << " duplicates, " << framesSent << " frames";
+    return line.str();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "OscRecording.h"
+
+// Loopback stand-ins for a room full of Pis, for load testing the aggregator. Each
+// virtual node has its own hostname (sim-00, sim-01...), unique_id, frame sequence and
+// clock offset, and sends what a real node would:
+//
+// - with a recording (from aggregator --record), every node replays it in a loop from
+//   its own starting point, with hostname, unique_id, seq and timestamp rewritten so the
+//   nodes and the loops stay distinguishable: the arguments of batched messages, the
+//   header inside compact /wire packets, and the trailing timestamp of per-item messages
+// - without one, every node generates a batched /blobs message and /contours split over
+//   several parts per frame, messagesPerFrame items each
+//
+// A fraction of messages can be sent twice, and timestamps can be jittered, to exercise
+// the aggregator's dedupe and clock alignment.
+class NodeSimulator {
+
+    public:
+        struct Settings {
+            int numNodes = 8;
+            string host = "localhost";
+            int port = 7110;
+            string recordingPath; // empty to generate
+            int frameRate = 30;
+            int messagesPerFrame = 16; // blobs and contours per frame per node
+            float duplicateRate = 0; // 0 to 1
+            int jitterMillis = 0; // random delay added to each frame's timestamp
+        };
+
+        bool setup(const Settings& settings);
+
+        // call often, sends whatever is due
+        void update();
+
+        uint64_t getMessagesSent() const { return messagesSent; }
+        string getStatsLine() const;
+
+    protected:
+        struct Node {
+            string hostName, sessionId;
+            int64_t clockOffset; // ms, added to this node's timestamps
+            uint64_t seq = 0;
+            uint64_t nextFrame = 0; // micros
+
+            // replay
+            size_t next = 0;
+            uint64_t loopStart = 0;
+            uint64_t loops = 0;
+        };
+
+        void generate(Node& node, uint64_t now);
+        void replay(Node& node, uint64_t now);
+        void send(const ofxOscMessage& message);
+        void sendBatch(Node& node, const string& address, int64_t timestamp, int count, size_t itemFloats);
+
+        Settings settings;
+        ofxOscSender sender;
+        vector<Node> nodes;
+        uint64_t start = 0;
+
+        // the recording, loaded once and shared by every node
+        vector<pair<uint64_t, ofxOscMessage>> recording;
+        uint64_t recordingSpan = 0; // micros
+        uint64_t recordingSeqSpan = 0; // seq numbers
+
+        // reused every frame
+        vector<float> payload;
+        ofBuffer partBuffer;
+        vector<uint8_t> wirePacket;
+
+        uint64_t messagesSent = 0, duplicatesSent = 0, framesSent = 0;
+
+};
@@ -0,0 +1,152 @@
+#include "OscRecording.h"
+
+namespace OscRecording {
+
+static const char MAGIC[4] = { 'P', 'O', 'R', '1' };
+
+template <typename T>
+static void put(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void putString(string& out, const char* data, uint32_t size) {
+    put(out, size);
+    out.append(data, size);
+}
+
+void serialize(const ofxOscMessage& message, string& out) {
+    putString(out, message.getAddress().data(), message.getAddress().size());
+    put(out, uint32_t(message.getNumArgs()));
+    for (size_t i = 0; i < message.getNumArgs(); i++) {
+        char type = char(message.getArgType(i));
+        put(out, type);
+        switch (type) {
+            case 'i': put(out, message.getArgAsInt32(i)); break;
+            case 'h': put(out, message.getArgAsInt64(i)); break;
+            case 'f': put(out, message.getArgAsFloat(i)); break;
+            case 'd': put(out, message.getArgAsDouble(i)); break;
+            case 's': {
+                const string& value = message.getArgAsString(i);
+                putString(out, value.data(), value.size());
+                break;
+            }
+            case 'b': {
+                ofBuffer blob = message.getArgAsBlob(i);
+                putString(out, blob.getData(), blob.size());
+                break;
+            }
+            default: break; // T, F carry no data
+        }
+    }
+}
+
+class Cursor {
+    public:
+        Cursor(const char* data, size_t size) : p(data), end(data + size) { }
+
+        template <typename T>
+        T get() {
+            T value {};
+            if (size_t(end - p) < sizeof(T)) {
+                failed = true;
+                return value;
+            }
+            memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+
+        const char* bytes(uint32_t& size) {
+            size = get<uint32_t>();
+            if (failed || size_t(end - p) < size) {
+                failed = true;
+                return nullptr;
+            }
+            const char* data = p;
+            p += size;
+            return data;
+        }
+
+        bool failed = false;
+
+    private:
+        const char* p;
+        const char* end;
+};
+
+bool deserialize(const char* data, size_t size, ofxOscMessage& message) {
+    Cursor in(data, size);
+    message.clear();
+
+    uint32_t length;
+    const char* address = in.bytes(length);
+    if (in.failed) return false;
+    message.setAddress(string(address, length));
+
+    uint32_t numArgs = in.get<uint32_t>();
+    for (uint32_t i = 0; i < numArgs && !in.failed; i++) {
+        char type = in.get<char>();
+        switch (type) {
+            case 'i': message.addIntArg(in.get<int32_t>()); break;
+            case 'h': message.addInt64Arg(in.get<int64_t>()); break;
+            case 'f': message.addFloatArg(in.get<float>()); break;
+            case 'd': message.addDoubleArg(in.get<double>()); break;
+            case 's': {
+                const char* value = in.bytes(length);
+                if (value) message.addStringArg(string(value, length));
+                break;
+            }
+            case 'b': {
+                const char* value = in.bytes(length);
+                if (value) message.addBlobArg(ofBuffer(value, length));
+                break;
+            }
+            case 'T': message.addBoolArg(true); break;
+            case 'F': message.addBoolArg(false); break;
+            default: return false;
+        }
+    }
+    return !in.failed;
+}
+
+// ~ ~ ~ FILES ~ ~ ~
+bool Writer::open(const string& path) {
+    file.open(ofToDataPath(path, true), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(MAGIC, sizeof MAGIC);
+    return true;
+}
+
+void Writer::write(uint64_t micros, const ofxOscMessage& message) {
+    scratch.clear();
+    serialize(message, scratch);
+    uint32_t size = scratch.size();
+    file.write(reinterpret_cast<const char*>(&micros), sizeof micros);
+    file.write(reinterpret_cast<const char*>(&size), sizeof size);
+    file.write(scratch.data(), size);
+}
+
+void Writer::close() {
+    file.close();
+}
+
+bool Reader::open(const string& path) {
+    file.open(ofToDataPath(path, true), std::ios::binary);
+    char magic[4];
+    return file.read(magic, sizeof magic) && memcmp(magic, MAGIC, sizeof magic) == 0;
+}
+
+bool Reader::read(uint64_t& micros, ofxOscMessage& message) {
+    uint32_t size;
+    if (!file.read(reinterpret_cast<char*>(&micros), sizeof micros) || !file.read(reinterpret_cast<char*>(&size), sizeof size)) return false;
+    scratch.resize(size);
+    if (!file.read(&scratch[0], size)) return false;
+    return deserialize(scratch.data(), size, message);
+}
+
+void Reader::rewind() {
+    file.clear();
+    file.seekg(sizeof MAGIC);
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+
+// Flat binary serialization of OSC messages, used for recording sessions to replay with
+// the node simulator and for hashing message contents. Little-endian, native layout:
+//
+//   file:    "POR1", then records
+//   record:  u64 micros since the start of the recording, u32 size, message
+//   message: address, type tags, then each argument (strings and blobs are u32 length + bytes)
+//
+// Handles the types Pinopticam sends: i h f d s b T F.
+namespace OscRecording {
+
+    // appends to out
+    void serialize(const ofxOscMessage& message, string& out);
+    // false on a truncated or unknown message
+    bool deserialize(const char* data, size_t size, ofxOscMessage& message);
+
+    class Writer {
+        public:
+            bool open(const string& path);
+            void write(uint64_t micros, const ofxOscMessage& message);
+            void close();
+            bool isOpen() const { return file.is_open(); }
+
+        protected:
+            std::ofstream file;
+            string scratch;
+    };
+
+    class Reader {
+        public:
+            bool open(const string& path);
+            // false at the end of the file
+            bool read(uint64_t& micros, ofxOscMessage& message);
+            void rewind();
+
+        protected:
+            std::ifstream file;
+            string scratch;
+    };
+
+}
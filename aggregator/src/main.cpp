@@ -0,0 +1,66 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "AggregatorApp.h"
+
+static void splitHostPort(const string& value, string& host, int& port) {
+    size_t colon = value.rfind(':');
+    if (colon == string::npos) {
+        host = value;
+        return;
+    }
+    if (colon > 0) host = value.substr(0, colon);
+    port = ofToInt(value.substr(colon + 1));
+}
+
+//========================================================================
+// aggregator [--port N] [--out host:port] [--rate N] [--delay ms] [--max-pending N]
+//            [--max-nodes N] [--record file] [--seconds N]
+// aggregator --simulate N [--to host:port] [--recording file] [--rate N] [--messages N]
+//            [--duplicates p] [--jitter ms] [--seconds N]
+int main(int argc, char* argv[]) {
+    AggregatorApp::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) {
+            options.aggregator.port = ofToInt(argv[++i]);
+        } else if (arg == "--out" && hasValue) {
+            splitHostPort(argv[++i], options.aggregator.outHost, options.aggregator.outPort);
+        } else if (arg == "--rate" && hasValue) {
+            options.aggregator.tickRate = options.simulator.frameRate = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--delay" && hasValue) {
+            options.aggregator.alignDelay = max(ofToInt(argv[++i]), 0);
+        } else if (arg == "--max-pending" && hasValue) {
+            options.aggregator.maxPendingPerNode = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--max-nodes" && hasValue) {
+            options.aggregator.maxNodes = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--record" && hasValue) {
+            options.aggregator.recordPath = argv[++i];
+        } else if (arg == "--simulate" && hasValue) {
+            options.simulate = true;
+            options.simulator.numNodes = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--to" && hasValue) {
+            splitHostPort(argv[++i], options.simulator.host, options.simulator.port);
+        } else if (arg == "--recording" && hasValue) {
+            options.simulator.recordingPath = argv[++i];
+        } else if (arg == "--messages" && hasValue) {
+            options.simulator.messagesPerFrame = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--duplicates" && hasValue) {
+            options.simulator.duplicateRate = ofClamp(ofToFloat(argv[++i]), 0, 1);
+        } else if (arg == "--jitter" && hasValue) {
+            options.simulator.jitterMillis = max(ofToInt(argv[++i]), 0);
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = max(ofToFloat(argv[++i]), 0.0f);
+        } else {
+            cerr << "usage: " << argv[0] << " [--port N] [--out host:port] [--rate N] [--delay ms] [--max-pending N] [--max-nodes N] [--record file] [--seconds N]" << endl;
+            cerr << "       " << argv[0] << " --simulate N [--to host:port] [--recording file] [--rate N] [--messages N] [--duplicates p] [--jitter ms] [--seconds N]" << endl;
+            return 1;
+        }
+    }
+
+    // no window and no GL, it's a network service
+    auto window = make_shared<ofAppNoWindow>();
+    ofRunApp(window, make_shared<AggregatorApp>(options));
+    return ofRunMainLoop();
+}
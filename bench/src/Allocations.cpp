@@ -0,0 +1,107 @@
+#include "Allocations.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> numAllocations { 0 };
+
+uint64_t getNumAllocations() {
+    return numAllocations.load(std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+
+// glibc exports its allocator under these names as well, so the malloc family can be
+// replaced here for the whole process without dlsym. operator new from libstdc++ calls
+// malloc, so it's counted once, below.
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+// growing in place is still a call into the allocator, so every realloc counts
+void* realloc(void* p, size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+// OpenCV's fastMalloc
+int posix_memalign(void** p, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void* block = memalign(alignment, size);
+    if (!block) return ENOMEM;
+    *p = block;
+    return 0;
+}
+
+}
+
+const char* getAllocationCounter() {
+    return "malloc";
+}
+
+#else
+
+const char* getAllocationCounter() {
+    return "operator_new";
+}
+
+void* operator new(std::size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Every heap allocation in the process, on any thread, since startup. With glibc that's
+// every malloc, calloc, realloc and aligned allocation, which takes in operator new and
+// OpenCV's and libjpeg's own buffers too; elsewhere only operator new can be counted.
+// Counted by the replacements in Allocations.cpp.
+uint64_t getNumAllocations();
+
+// what getNumAllocations() counts, "malloc" or "operator_new", for the results
+const char* getAllocationCounter();
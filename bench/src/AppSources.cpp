@@ -0,0 +1,22 @@
+// The app's modules under benchmark, compiled from ../src so the numbers always come
+// from the code the app runs. The app's main.cpp, ofApp and the Pi camera are left out.
+
+#include "../../src/Metrics.cpp"
+#include "../../src/WorkerPool.cpp"
+#include "../../src/PeakFinder.cpp"
+#include "../../src/ContourSlicer.cpp"
+#include "../../src/BlobTracker.cpp"
+#include "../../src/ChangeDetector.cpp"
+#include "../../src/FrameScheduler.cpp"
+#include "../../src/AreaDownsampler.cpp"
+#include "../../src/ProcessingPyramid.cpp"
+#include "../../src/FrameArena.cpp"
+#include "../../src/FrameBuffer.cpp"
+#include "../../src/FrameSource.cpp"
+#include "../../src/FrameGrabber.cpp"
+#include "../../src/VisionPipeline.cpp"
+#include "../../src/JpegCache.cpp"
+#include "../../src/WireFormat.cpp"
+#include "../../src/ClientPacer.cpp"
+#include "../../src/WsClients.cpp"
+#include "../../src/BatchSender.cpp"
@@ -0,0 +1,227 @@
+#include "BenchApp.h"
+#include "Allocations.h"
+
+#include "../../../common/src/Pinopticon.hpp"
+
+#include <chrono>
+
+using namespace Pinopticon;
+
+#define BENCH_OSC_PORT 7199 // loopback only
+#define BENCH_THUMB_WIDTH 120
+#define BENCH_THUMB_HEIGHT 90
+#define BENCH_VIDEO_QUALITY 3 // as osc_video_quality
+#define BENCH_DEFAULT_SLICES 10
+#define BENCH_PEAKS 8
+
+void BenchApp::setup() {
+    ofSetLogLevel(OF_LOG_WARNING);
+    ofSeedRandom(0);
+
+    jpegCache.setup(2);
+    thumbnail.setUseTexture(false);
+
+    receiver.setup(BENCH_OSC_PORT);
+    sender.setup("127.0.0.1", BENCH_OSC_PORT);
+    floatSender.setup(&sender, &wsClients, "bench", "bench", 1400, false);
+    compactSender.setup(&sender, &wsClients, "bench", "bench", 1400, true);
+
+    vector<glm::ivec2> resolutions { { 320, 240 }, { 640, 480 }, { 1280, 960 } };
+    vector<int> densities { 4, 16, 64 };
+    if (options.quick) {
+        resolutions = { { 640, 480 } };
+        densities = { 16 };
+    }
+
+    for (auto& resolution : resolutions) {
+        for (int density : densities) {
+            runConfig(resolution.x, resolution.y, density);
+        }
+    }
+
+    receiver.stop();
+
+    string json = toJson();
+    cout << json << endl;
+    if (!options.outFile.empty()) {
+        ofBuffer buffer(json.c_str(), json.size());
+        if (!ofBufferToFile(options.outFile, buffer)) ofLogError("BenchApp") << "can't write " << options.outFile;
+    }
+
+    ofExit(0);
+}
+
+void BenchApp::setupPipeline(bool contours, int slices, int peaks) {
+    settings.blobs = true;
+    settings.contours = contours;
+    settings.brightestPixel = true;
+    settings.contourSlices = slices;
+    settings.contourThreads = options.contourThreads;
+    settings.peaks = peaks;
+    pipeline.setup(grabber, settings);
+}
+
+// ~ ~ ~ STAGES ~ ~ ~
+void BenchApp::runConfig(int _width, int _height, int _numBlobs) {
+    width = _width;
+    height = _height;
+    numBlobs = _numBlobs;
+
+    makeFrame(frame);
+
+    setupPipeline(false, BENCH_DEFAULT_SLICES, 1);
+    measure("convert", 0, [this]() { pipeline.convert(frame, job); });
+    measure("pyramid", 0, [this]() { pipeline.buildPyramid(job); });
+    measure("blobs", 0, [this]() { pipeline.findBlobs(job); });
+    measure("brightest_pixel", 0, [this]() { pipeline.findBrightestPixel(job); });
+
+    // every analysis at half resolution, from a pyramid level
+    settings.blobsLevel = settings.contoursLevel = settings.brightestPixelLevel = 1;
+    setupPipeline(true, BENCH_DEFAULT_SLICES, 1);
+    measure("pyramid_half", 0, [this]() { pipeline.buildPyramid(job); });
+    measure("blobs_half", 0, [this]() { pipeline.findBlobs(job); });
+    measure("contours_half", BENCH_DEFAULT_SLICES, [this]() { pipeline.findContours(job); });
+    measure("brightest_pixel_half", 0, [this]() { pipeline.findBrightestPixel(job); });
+    settings.blobsLevel = settings.contoursLevel = settings.brightestPixelLevel = 0;
+    setupPipeline(false, BENCH_DEFAULT_SLICES, 1);
+    pipeline.buildPyramid(job);
+
+    // steady state of the tracker: region scans, with a full scan every 30 frames
+    settings.blobTracking = true;
+    setupPipeline(false, BENCH_DEFAULT_SLICES, 1);
+    measure("blobs_tracked", 0, [this]() { pipeline.findBlobs(job); });
+    settings.blobTracking = false;
+
+    // a static scene, so every tile is compared and the frame is skipped
+    settings.changeDetection = true;
+    setupPipeline(false, BENCH_DEFAULT_SLICES, 1);
+    pipeline.hasChanged(frame);
+    pipeline.commitChange(); // the reference, as if the first frame had been analysed
+    measure("change_detect", 0, [this]() { pipeline.hasChanged(frame); });
+    settings.changeDetection = false;
+
+    setupPipeline(false, BENCH_DEFAULT_SLICES, BENCH_PEAKS);
+    measure("brightest_pixel_peaks", 0, [this]() { pipeline.findBrightestPixel(job); });
+
+    vector<int> sliceCounts { 5, 10, 20 };
+    if (options.quick) sliceCounts = { BENCH_DEFAULT_SLICES };
+    for (int slices : sliceCounts) {
+        setupPipeline(true, slices, 1);
+        measure("contours", slices, [this]() { pipeline.findContours(job); });
+        measure("pack_contours", slices, [this]() { pipeline.packContours(job); });
+    }
+
+    // the packing stages below send whatever the last config found
+    setupPipeline(true, BENCH_DEFAULT_SLICES, 1);
+    pipeline.findBlobs(job);
+    pipeline.findContours(job);
+    pipeline.findBrightestPixel(job);
+
+    int quality = JpegCache::qualityFromLevel(BENCH_VIDEO_QUALITY);
+    measure("thumbnail_jpeg_cache", 0, [this, quality]() {
+        jpeg = jpegCache.get(++jpegSeq, job.pixels, BENCH_THUMB_WIDTH, BENCH_THUMB_HEIGHT, quality);
+    }, [this]() { return jpeg->size(); });
+    measure("stream_jpeg_cache", 0, [this]() {
+        jpeg = jpegCache.get(++jpegSeq, job.pixels, 0, 0, 50);
+    }, [this]() { return jpeg->size(); });
+
+    // the encode the app used before the JpegCache, from the common helpers
+    measure("thumbnail_image_to_buffer", 0, [this]() {
+        thumbnail.setFromPixels(job.pixels);
+        thumbnail.resize(BENCH_THUMB_WIDTH, BENCH_THUMB_HEIGHT);
+        imageToBuffer(thumbnail, thumbnailBuffer, BENCH_VIDEO_QUALITY);
+    }, [this]() { return thumbnailBuffer.size(); });
+
+    measure("pack_batch_float", BENCH_DEFAULT_SLICES, [this]() {
+        floatSender.sendBlobs(job);
+        floatSender.sendContours(job);
+        floatSender.sendPixels(job);
+    });
+    measure("pack_batch_compact", BENCH_DEFAULT_SLICES, [this]() {
+        compactSender.sendBlobs(job);
+        compactSender.sendContours(job);
+        compactSender.sendPixels(job);
+    });
+}
+
+void BenchApp::measure(const string& stage, int slices, std::function<void()> run, std::function<size_t()> outputBytes) {
+    for (int i = 0; i < options.warmup; i++) run();
+
+    uint64_t bytes = 0;
+    uint64_t allocationsBefore = getNumAllocations();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < options.iterations; i++) {
+        run();
+        if (outputBytes) bytes += outputBytes();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocations = getNumAllocations() - allocationsBefore;
+
+    Result result;
+    result.stage = stage;
+    result.width = width;
+    result.height = height;
+    result.blobs = numBlobs;
+    result.slices = slices;
+    result.nsPerFrame = double(elapsed) / options.iterations;
+    result.allocationsPerFrame = double(allocations) / options.iterations;
+    result.framesPerSecond = result.nsPerFrame > 0 ? 1e9 / result.nsPerFrame : 0;
+    result.bytesPerFrame = double(bytes) / options.iterations;
+    results.push_back(result);
+
+    cerr << stage << " " << width << "x" << height << " blobs " << numBlobs << " slices " << slices << ": " << int64_t(result.nsPerFrame) << " ns, " << result.allocationsPerFrame << " allocs" << endl;
+}
+
+// Dark noisy background with soft round blobs, from a fixed seed so every run and every
+// build sees exactly the same frames. The blobs have a falloff so every contour slice
+// finds something.
+void BenchApp::makeFrame(Frame& frame) {
+    cv::RNG rng(0x50494e4f); // fixed seed
+    frame.buffer = make_shared<FrameBuffer>(width, height, 1);
+    frame.mat = frame.buffer->mat;
+    rng.fill(frame.mat, cv::RNG::UNIFORM, 0, 40);
+
+    float scale = width / 640.0f;
+    cv::Mat blobs = cv::Mat::zeros(height, width, CV_8UC1);
+    for (int i = 0; i < numBlobs; i++) {
+        cv::Point center(rng.uniform(0, width), rng.uniform(0, height));
+        int radius = max(int(rng.uniform(4, 20) * scale), 2);
+        cv::circle(blobs, center, radius, cv::Scalar(rng.uniform(160, 256)), -1);
+    }
+    int kernel = max(int(9 * scale), 1) | 1;
+    cv::GaussianBlur(blobs, blobs, cv::Size(kernel, kernel), 0);
+    cv::max(frame.mat, blobs, frame.mat);
+
+    frame.seq = 1;
+    frame.timestamp = 0;
+    frame.grabMicros = 0;
+}
+
+// ~ ~ ~ OUTPUT ~ ~ ~
+string BenchApp::toJson() const {
+    ostringstream json;
+    json << "{\"timestamp\":\"" << ofGetTimestampString("%Y-%m-%dT%H:%M:%S") << "\"";
+    json << ",\"compiler\":\"" << __VERSION__ << "\"";
+    json << ",\"peak_kernel\":\"" << PeakFinder::getKernelName() << "\"";
+#ifdef PINOPTICAM_TURBOJPEG
+    json << ",\"jpeg\":\"turbojpeg\"";
+#else
+    json << ",\"jpeg\":\"freeimage\"";
+#endif
+    json << ",\"allocation_counter\":\"" << getAllocationCounter() << "\"";
+    json << ",\"contour_threads\":" << options.contourThreads;
+    json << ",\"iterations\":" << options.iterations;
+    json << ",\"results\":[";
+    for (int i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        if (i > 0) json << ",";
+        json << "\n{\"stage\":\"" << r.stage << "\",\"width\":" << r.width << ",\"height\":" << r.height
+             << ",\"blobs\":" << r.blobs << ",\"slices\":" << r.slices
+             << ",\"ns_per_frame\":" << int64_t(r.nsPerFrame) << ",\"allocations_per_frame\":" << r.allocationsPerFrame
+             << ",\"frames_per_second\":" << r.framesPerSecond << ",\"bytes_per_frame\":" << r.bytesPerFrame << "}";
+    }
+    json << "\n]}";
+    return json.str();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "ofxOsc.h"
+#include "FrameGrabber.h"
+#include "VisionPipeline.h"
+#include "JpegCache.h"
+#include "WsClients.h"
+#include "BatchSender.h"
+
+// Opens up the pipeline's stages so they can be timed one at a time, on the calling thread.
+class StagePipeline : public VisionPipeline {
+
+    public:
+        using VisionPipeline::convert;
+        using VisionPipeline::findBlobs;
+        using VisionPipeline::findContours;
+        using VisionPipeline::findBrightestPixel;
+        using VisionPipeline::packContours;
+        using VisionPipeline::hasChanged;
+        using VisionPipeline::buildPyramid;
+
+        void commitChange() { changeDetector.commit(); }
+
+};
+
+// Feeds fixed, generated test frames through the app's own vision, encoding and packing
+// code and reports what each stage costs per frame as JSON, so builds and settings can
+// be compared. Sweeps resolution, blob density and contour slice count.
+class BenchApp : public ofBaseApp {
+
+    public:
+        struct Options {
+            int iterations = 100; // timed runs per stage
+            int warmup = 5; // untimed runs first, so buffers are allocated and caches are warm
+            int contourThreads = 3;
+            bool quick = false; // one resolution, one density, one slice count
+            string outFile; // empty for stdout only
+        };
+
+        BenchApp(const Options& options) : options(options) { }
+
+        void setup() override; // runs everything, then exits
+
+    protected:
+        struct Result {
+            string stage;
+            int width, height;
+            int blobs; // generated blobs in the frame
+            int slices; // contour slices, 0 where it doesn't apply
+            double nsPerFrame;
+            double allocationsPerFrame;
+            double framesPerSecond;
+            double bytesPerFrame; // output size, 0 where it doesn't apply
+        };
+
+        void runConfig(int width, int height, int numBlobs);
+        void measure(const string& stage, int slices, std::function<void()> run, std::function<size_t()> outputBytes = nullptr);
+        void makeFrame(Frame& frame); // for the current config
+        void setupPipeline(bool contours, int slices, int peaks);
+        string toJson() const;
+
+        Options options;
+        vector<Result> results;
+        int width = 0, height = 0, numBlobs = 0; // the config being measured
+
+        Frame frame;
+        FrameJob job;
+        FrameGrabber grabber; // never started, the pipeline just needs one
+        StagePipeline pipeline;
+        VisionPipeline::Settings settings;
+
+        JpegCache jpegCache;
+        uint64_t jpegSeq = 0;
+        JpegCache::Jpeg jpeg;
+        ofImage thumbnail;
+        ofBuffer thumbnailBuffer;
+
+        ofxOscSender sender;
+        ofxOscReceiver receiver; // soaks up the packets so the sends behave like the real thing
+        WsClients wsClients; // no clients, so only the packing is measured
+        BatchSender floatSender, compactSender;
+
+};
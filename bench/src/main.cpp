@@ -0,0 +1,31 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "BenchApp.h"
+
+//========================================================================
+// bench [--quick] [--iterations N] [--threads N] [--out results.json]
+int main(int argc, char* argv[]) {
+    BenchApp::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--threads" && hasValue) {
+            options.contourThreads = max(ofToInt(argv[++i]), 1);
+        } else if (arg == "--out" && hasValue) {
+            options.outFile = argv[++i];
+        } else {
+            cerr << "usage: " << argv[0] << " [--quick] [--iterations N] [--threads N] [--out results.json]" << endl;
+            return 1;
+        }
+    }
+
+    // no window and no GL, so it runs on build boxes and over ssh
+    auto window = make_shared<ofAppNoWindow>();
+    ofRunApp(window, make_shared<BenchApp>(options));
+    return ofRunMainLoop();
+}
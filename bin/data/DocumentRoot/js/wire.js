@@ -0,0 +1,101 @@
+"use strict";
+
+// Reader for the compact binary wire format, see src/WireFormat.h.
+// Pass the ArrayBuffer of a binary WebSocket message (set ws.binaryType = "arraybuffer")
+// or an OSC blob; returns null if it isn't a version 1 packet.
+
+var WIRE_BLOBS = 1;
+var WIRE_CONTOURS = 2;
+var WIRE_PIXELS = 3;
+
+function WireReader(buffer) {
+    this.bytes = new Uint8Array(buffer);
+    this.pos = 0;
+    this.failed = false;
+}
+
+WireReader.prototype.byte = function() {
+    if (this.pos >= this.bytes.length) {
+        this.failed = true;
+        return 0;
+    }
+    return this.bytes[this.pos++];
+};
+
+// plain arithmetic instead of bit shifts, which would truncate to 32 bits
+WireReader.prototype.varint = function() {
+    var value = 0;
+    var scale = 1;
+    for (var i = 0; i < 10; i++) {
+        var b = this.byte();
+        value += (b & 0x7f) * scale;
+        if ((b & 0x80) === 0) return value;
+        scale *= 128;
+    }
+    this.failed = true;
+    return 0;
+};
+
+WireReader.prototype.svarint = function() {
+    var v = this.varint();
+    return (v % 2 === 0) ? v / 2 : -(v + 1) / 2;
+};
+
+function decodeWirePacket(buffer) {
+    var r = new WireReader(buffer);
+
+    if (r.byte() !== 0x50 || r.byte() !== 0x57) return null; // "PW"
+    var packet = { version: r.byte() };
+    if (packet.version !== 1) return null;
+    packet.type = r.byte();
+    var fracBits = r.byte();
+    if (fracBits > 24) return null; // the encoder's limit, and past 31 the shift wraps
+    var scale = 1.0 / (1 << fracBits);
+
+    packet.seq = r.varint();
+    packet.timestamp = r.svarint();
+    packet.total = r.varint();
+    packet.part = r.varint();
+    packet.parts = r.varint();
+    var count = r.varint();
+
+    packet.blobs = [];
+    packet.contours = [];
+    packet.pixels = [];
+
+    for (var i = 0; i < count && !r.failed; i++) {
+        if (packet.type === WIRE_BLOBS) {
+            packet.blobs.push({
+                index: r.varint(),
+                x: r.svarint() * scale,
+                y: r.svarint() * scale,
+                radius: r.varint() * scale
+            });
+        } else if (packet.type === WIRE_CONTOURS) {
+            var contour = {
+                color: [r.byte(), r.byte(), r.byte()],
+                brightness: r.byte(),
+                points: []
+            };
+            var numPoints = r.varint();
+            var x = 0;
+            var y = 0;
+            for (var j = 0; j < numPoints && !r.failed; j++) {
+                x += r.svarint();
+                y += r.svarint();
+                contour.points.push(x * scale, y * scale);
+            }
+            packet.contours.push(contour);
+        } else if (packet.type === WIRE_PIXELS) {
+            packet.pixels.push({
+                x: r.svarint() * scale,
+                y: r.svarint() * scale,
+                brightness: r.byte()
+            });
+        } else {
+            return null;
+        }
+    }
+
+    return r.failed ? null : packet;
+}
@@ -0,0 +1,83 @@
+#include "AreaDownsampler.h"
+#include <algorithm>
+
+// spans are at least one source pixel, so upscaling degrades to nearest neighbour
+static void makeSpans(int srcSize, int dstSize, std::vector<int>& begin, std::vector<int>& end) {
+    begin.resize(dstSize);
+    end.resize(dstSize);
+    for (int i = 0; i < dstSize; i++) {
+        begin[i] = std::min(int(int64_t(i) * srcSize / dstSize), srcSize - 1);
+        end[i] = std::max(int(int64_t(i + 1) * srcSize / dstSize), begin[i] + 1);
+    }
+}
+
+bool AreaDownsampler::setup(int _srcWidth, int _srcHeight, int _dstWidth, int _dstHeight, int _channels) {
+    if (_srcWidth == srcWidth && _srcHeight == srcHeight && _dstWidth == dstWidth && _dstHeight == dstHeight && _channels == channels) return false;
+
+    srcWidth = _srcWidth;
+    srcHeight = _srcHeight;
+    dstWidth = _dstWidth;
+    dstHeight = _dstHeight;
+    channels = _channels;
+    halving = srcWidth == dstWidth * 2 && srcHeight == dstHeight * 2;
+
+    makeSpans(srcWidth, dstWidth, colBegin, colEnd);
+    makeSpans(srcHeight, dstHeight, rowBegin, rowEnd);
+    rowSums.resize(dstWidth * channels);
+    return true;
+}
+
+void AreaDownsampler::run(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride) const {
+    if (halving) {
+        runHalving(src, srcStride, dst, dstStride);
+        return;
+    }
+
+    for (int y = 0; y < dstHeight; y++) {
+        std::fill(rowSums.begin(), rowSums.end(), 0);
+
+        // sum the covered source rows column span by column span
+        for (int sy = rowBegin[y]; sy < rowEnd[y]; sy++) {
+            const uint8_t* row = src + sy * srcStride;
+            uint32_t* sums = rowSums.data();
+            for (int x = 0; x < dstWidth; x++, sums += channels) {
+                const uint8_t* pixel = row + colBegin[x] * channels;
+                const uint8_t* pixelEnd = row + colEnd[x] * channels;
+                for (; pixel < pixelEnd; pixel += channels) {
+                    for (int c = 0; c < channels; c++) sums[c] += pixel[c];
+                }
+            }
+        }
+
+        uint8_t* out = dst + y * dstStride;
+        const uint32_t* sums = rowSums.data();
+        int rows = rowEnd[y] - rowBegin[y];
+        for (int x = 0; x < dstWidth; x++, sums += channels, out += channels) {
+            uint32_t area = rows * (colEnd[x] - colBegin[x]);
+            for (int c = 0; c < channels; c++) out[c] = (sums[c] + area / 2) / area;
+        }
+    }
+}
+
+// straight loops over two rows at a time that the compiler can vectorize
+void AreaDownsampler::runHalving(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride) const {
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t* top = src + y * 2 * srcStride;
+        const uint8_t* bottom = top + srcStride;
+        uint8_t* out = dst + y * dstStride;
+
+        if (channels == 1) {
+            for (int x = 0; x < dstWidth; x++) {
+                out[x] = (top[x * 2] + top[x * 2 + 1] + bottom[x * 2] + bottom[x * 2 + 1] + 2) >> 2;
+            }
+        } else {
+            for (int x = 0; x < dstWidth; x++) {
+                const uint8_t* a = top + x * 2 * channels;
+                const uint8_t* b = bottom + x * 2 * channels;
+                for (int c = 0; c < channels; c++) {
+                    out[x * channels + c] = (a[c] + a[c + channels] + b[c] + b[c + channels] + 2) >> 2;
+                }
+            }
+        }
+    }
+}
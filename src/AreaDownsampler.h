@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Box-filter downscale for 8-bit gray / RGB / RGBA images: every destination pixel is the
+// average of the source pixels it covers, so thumbnails don't alias the way nearest
+// neighbour does. The column spans and the row accumulator are worked out by setup() and
+// reused for every frame of that size, so run() doesn't allocate. An exact halving takes
+// a 2x2 kernel with the same rounding instead. Not thread-safe, give each thread its own.
+class AreaDownsampler {
+
+    public:
+        // returns true if the tables had to be rebuilt, i.e. the sizes changed
+        bool setup(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int channels);
+
+        void run(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride) const;
+
+    protected:
+        void runHalving(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride) const;
+
+        bool halving = false; // every destination pixel is exactly 2x2 source pixels
+        int srcWidth = 0, srcHeight = 0, dstWidth = 0, dstHeight = 0, channels = 0;
+        std::vector<int> colBegin, colEnd; // source columns [begin, end) for each destination column
+        std::vector<int> rowBegin, rowEnd;
+        mutable std::vector<uint32_t> rowSums; // dstWidth * channels
+};
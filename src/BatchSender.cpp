@@ -0,0 +1,260 @@
+#include "BatchSender.h"
+#include "Metrics.h"
+
+// address, type tags, 4 int args and the int64, with room to spare
+#define BATCH_OSC_HEADER_SIZE 64
+
+void BatchSender::setup(ofxOscSender* _sender, WsClients* _wsClients, string _hostName, string _sessionId, int _maxPacketSize, bool _compact) {
+    sender = _sender;
+    wsClients = _wsClients;
+    hostName = _hostName;
+    sessionId = _sessionId;
+    maxPacketSize = _maxPacketSize;
+    compact = _compact;
+}
+
+void BatchSender::beginItem() {
+    itemStarts.push_back(payload.size());
+}
+
+void BatchSender::addFloat(float value) {
+    payload.push_back(value);
+}
+
+// ~ ~ ~ ANALYSES ~ ~ ~
+void BatchSender::sendBlobs(FrameJob& job) {
+    if (compact) {
+        encoder.begin(WireEncoder::BLOBS);
+        for (auto& blob : job.blobs) {
+            encoder.addBlob(blob.index, blob.center.x, blob.center.y, blob.radius);
+        }
+        sendWire(job);
+        return;
+    }
+
+    payload.clear();
+    itemStarts.clear();
+    for (auto& blob : job.blobs) {
+        beginItem();
+        addFloat(blob.index);
+        addFloat(blob.center.x);
+        addFloat(blob.center.y);
+        addFloat(blob.radius);
+    }
+
+    if (sender) sendOsc("/blobs", job);
+    if (wsClients) {
+        beginJson("blobs", job, job.blobs.size());
+        for (int i = 0; i < job.blobs.size(); i++) {
+            const BlobResult& blob = job.blobs[i];
+            json += i == 0 ? "[" : ",[";
+            appendJsonNumber(blob.index);
+            json += ",";
+            appendJsonNumber(blob.center.x);
+            json += ",";
+            appendJsonNumber(blob.center.y);
+            json += ",";
+            appendJsonNumber(blob.radius);
+            json += "]";
+        }
+        sendWs();
+    }
+}
+
+void BatchSender::sendContours(FrameJob& job) {
+    if (compact) {
+        encoder.begin(WireEncoder::CONTOURS);
+        for (int i = 0; i < job.numContours; i++) {
+            const ContourResult& contour = job.contours[i];
+            uint8_t brightness = contour.points.empty() ? 0 : uint8_t(contour.points[0].z);
+            encoder.beginContour(contour.color.r, contour.color.g, contour.color.b, brightness, contour.points.size());
+            for (auto& point : contour.points) encoder.addContourPoint(point.x, point.y);
+        }
+        sendWire(job);
+        return;
+    }
+
+    payload.clear();
+    itemStarts.clear();
+    for (int i = 0; i < job.numContours; i++) {
+        const ContourResult& contour = job.contours[i];
+        beginItem();
+        addFloat(i);
+        addFloat(contour.color.r);
+        addFloat(contour.color.g);
+        addFloat(contour.color.b);
+        addFloat(contour.points.size());
+        for (auto& point : contour.points) {
+            addFloat(point.x);
+            addFloat(point.y);
+            addFloat(point.z);
+        }
+    }
+
+    if (sender) sendOsc("/contours", job);
+    if (wsClients) {
+        beginJson("contours", job, job.numContours);
+        for (int i = 0; i < job.numContours; i++) {
+            const ContourResult& contour = job.contours[i];
+            json += i == 0 ? "{\"index\":" : ",{\"index\":";
+            appendJsonNumber(i);
+            json += ",\"color\":[";
+            appendJsonNumber(contour.color.r);
+            json += ",";
+            appendJsonNumber(contour.color.g);
+            json += ",";
+            appendJsonNumber(contour.color.b);
+            json += "],\"points\":[";
+            for (int j = 0; j < contour.points.size(); j++) {
+                if (j > 0) json += ",";
+                appendJsonNumber(contour.points[j].x);
+                json += ",";
+                appendJsonNumber(contour.points[j].y);
+                json += ",";
+                appendJsonNumber(contour.points[j].z);
+            }
+            json += "]}";
+        }
+        sendWs();
+    }
+}
+
+void BatchSender::sendPixels(FrameJob& job) {
+    if (compact) {
+        encoder.begin(WireEncoder::PIXELS);
+        if (job.peaks.empty()) {
+            encoder.addPixel(job.pixel.x, job.pixel.y, job.pixel.brightness);
+        } else {
+            for (auto& peak : job.peaks) encoder.addPixel(peak.cx, peak.cy, peak.value);
+        }
+        sendWire(job);
+        return;
+    }
+
+    payload.clear();
+    itemStarts.clear();
+    if (job.peaks.empty()) {
+        beginItem();
+        addFloat(job.pixel.x);
+        addFloat(job.pixel.y);
+        addFloat(job.pixel.brightness);
+    } else {
+        for (auto& peak : job.peaks) {
+            beginItem();
+            addFloat(peak.cx);
+            addFloat(peak.cy);
+            addFloat(peak.value);
+        }
+    }
+
+    if (sender) sendOsc("/pixels", job);
+    if (wsClients) {
+        beginJson("pixels", job, itemStarts.size());
+        for (int i = 0; i < itemStarts.size(); i++) {
+            const float* item = &payload[itemStarts[i]];
+            json += i == 0 ? "[" : ",[";
+            appendJsonNumber(item[0]);
+            json += ",";
+            appendJsonNumber(item[1]);
+            json += ",";
+            appendJsonNumber(item[2]);
+            json += "]";
+        }
+        sendWs();
+    }
+}
+
+// ~ ~ ~ OSC ~ ~ ~
+void BatchSender::sendOsc(const string& address, FrameJob& job) {
+    ScopedMetric metric(Metrics::SEND_OSC);
+    int count = itemStarts.size();
+    size_t budget = max(maxPacketSize - BATCH_OSC_HEADER_SIZE - (int) (hostName.size() + sessionId.size()), 64);
+    size_t budgetFloats = budget / sizeof(float);
+
+    // work out the part boundaries first, so every part knows how many there are.
+    // An item bigger than the budget gets a part to itself and will be fragmented by IP.
+    partStarts.clear();
+    partStarts.push_back(0);
+    size_t partBegin = 0;
+    for (int i = 0; i < count; i++) {
+        size_t itemEnd = i + 1 < count ? itemStarts[i + 1] : payload.size();
+        if (itemEnd - partBegin > budgetFloats && itemStarts[i] > partBegin) {
+            partStarts.push_back(i);
+            partBegin = itemStarts[i];
+        }
+    }
+    int parts = partStarts.size();
+
+    for (int part = 0; part < parts; part++) {
+        int first = partStarts[part];
+        int last = part + 1 < parts ? partStarts[part + 1] : count;
+        size_t begin = first < count ? itemStarts[first] : payload.size();
+        size_t end = last < count ? itemStarts[last] : payload.size();
+
+        partBuffer.set(reinterpret_cast<const char *>(payload.data() + begin), (end - begin) * sizeof(float));
+
+        ofxOscMessage m;
+        m.setAddress(address);
+        m.addStringArg(hostName);
+        m.addStringArg(sessionId);
+        m.addInt64Arg(job.seq);
+        m.addIntArg(job.timestamp);
+        m.addIntArg(count);
+        m.addIntArg(part);
+        m.addIntArg(parts);
+        m.addBlobArg(partBuffer);
+        sender->sendMessage(m, false);
+        Metrics::get().add(Metrics::MESSAGES_OSC);
+        Metrics::get().add(Metrics::BYTES_OSC, partBuffer.size() + BATCH_OSC_HEADER_SIZE);
+    }
+}
+
+// ~ ~ ~ COMPACT ~ ~ ~
+void BatchSender::sendWire(FrameJob& job) {
+    if (sender) {
+        ScopedMetric metric(Metrics::SEND_OSC);
+        size_t budget = max(maxPacketSize - BATCH_OSC_HEADER_SIZE - (int) (hostName.size() + sessionId.size()), 64);
+        int parts = encoder.split(budget, partStarts);
+
+        for (int part = 0; part < parts; part++) {
+            int last = part + 1 < parts ? partStarts[part + 1] : encoder.getCount();
+            encoder.writePacket(packet, job.seq, job.timestamp, part, parts, partStarts[part], last);
+            partBuffer.set(reinterpret_cast<const char *>(packet.data()), packet.size());
+
+            ofxOscMessage m;
+            m.setAddress("/wire");
+            m.addStringArg(hostName);
+            m.addStringArg(sessionId);
+            m.addBlobArg(partBuffer);
+            sender->sendMessage(m, false);
+            Metrics::get().add(Metrics::MESSAGES_OSC);
+            Metrics::get().add(Metrics::BYTES_OSC, partBuffer.size() + BATCH_OSC_HEADER_SIZE);
+        }
+    }
+
+    if (wsClients) {
+        encoder.writePacket(packet, job.seq, job.timestamp);
+        wsClients->broadcast(ofxHTTP::WebSocketFrame(reinterpret_cast<const char *>(packet.data()), packet.size(), Poco::Net::WebSocket::FRAME_BINARY));
+    }
+}
+
+// ~ ~ ~ WEBSOCKETS ~ ~ ~
+void BatchSender::beginJson(const string& type, FrameJob& job, int count) {
+    json.clear();
+    json += "{\"unique_id\":\"" + sessionId + "\",\"hostname\":\"" + hostName + "\",\"type\":\"" + type + "\",\"seq\":";
+    json += ofToString(job.seq);
+    json += ",\"timestamp\":\"" + ofToString(job.timestamp) + "\",\"count\":";
+    json += ofToString(count);
+    json += ",\"" + type + "\":[";
+}
+
+void BatchSender::appendJsonNumber(float value) {
+    char number[32];
+    int n = snprintf(number, sizeof number, "%g", value);
+    json.append(number, n);
+}
+
+void BatchSender::sendWs() {
+    json += "]}";
+    wsClients->broadcast(ofxHTTP::WebSocketFrame(json));
+}
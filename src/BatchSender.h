@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "ofxHTTP.h"
+#include "WsClients.h"
+#include "FrameJob.h"
+#include "WireFormat.h"
+
+// Batched output: one OSC message and one WebSocket message per frame per analysis,
+// instead of one per blob / contour. Every batch carries the frame sequence number and
+// the total item count. OSC payloads are split on item boundaries into parts that each
+// fit in a single UDP packet, and each part says which part it is and how many there are.
+//
+// OSC:  /blobs    hostname, unique_id, seq (int64), timestamp, count, part, parts, blob
+//       /contours hostname, unique_id, seq (int64), timestamp, count, part, parts, blob
+//       /pixels   hostname, unique_id, seq (int64), timestamp, count, part, parts, blob
+// blob is packed little-endian float32 records:
+//       blob:    index, x, y, radius
+//       contour: index, r, g, b, numPoints, then numPoints * (x, y, z)
+//       pixel:   x, y, brightness
+// WebSockets get the same data as JSON, through the per-client queues in WsClients.
+//
+// With the compact wire format (see WireFormat.h) each part is a self-describing packet
+// instead: OSC /wire hostname, unique_id, blob, and one binary WebSocket frame per batch.
+class BatchSender {
+
+    public:
+        // either transport may be null to leave it out
+        void setup(ofxOscSender* sender, WsClients* wsClients, string hostName, string sessionId, int maxPacketSize, bool compact);
+
+        void sendBlobs(FrameJob& job);
+        void sendContours(FrameJob& job);
+        void sendPixels(FrameJob& job);
+
+    protected:
+        void beginItem();
+        void addFloat(float value);
+
+        void sendOsc(const string& address, FrameJob& job);
+        void sendWs();
+
+        void sendWire(FrameJob& job);
+
+        void beginJson(const string& type, FrameJob& job, int count);
+        void appendJsonNumber(float value);
+
+        ofxOscSender* sender = nullptr;
+        WsClients* wsClients = nullptr;
+        string hostName, sessionId;
+        int maxPacketSize = 1400;
+        bool compact = false;
+
+        // reused every frame so steady state doesn't allocate
+        vector<float> payload;
+        vector<size_t> itemStarts; // index into payload where each item begins
+        vector<int> partStarts; // first item of each OSC part
+        ofBuffer partBuffer;
+        string json;
+        WireEncoder encoder;
+        vector<uint8_t> packet;
+
+};
@@ -0,0 +1,126 @@
+#include "BlobTracker.h"
+#include "Metrics.h"
+
+using namespace ofxCv;
+
+void BlobTracker::setup(const Settings& _settings) {
+    settings = _settings;
+    settings.fullScanInterval = max(settings.fullScanInterval, 1);
+
+    finder.setMinAreaRadius(settings.minAreaRadius);
+    finder.setMaxAreaRadius(settings.maxAreaRadius);
+    finder.setThreshold(settings.contourThreshold);
+
+    tracker.setPersistence(settings.persistence);
+    tracker.setMaximumDistance(settings.maxDistance);
+
+    tracks.clear();
+    framesSinceFullScan = 0;
+    forceFullScan = true;
+}
+
+void BlobTracker::track(const cv::Mat& frame, FrameJob& job) {
+    cv::Rect bounds(0, 0, frame.cols, frame.rows);
+
+    bool fullScan = forceFullScan || tracks.empty() || ++framesSinceFullScan >= settings.fullScanInterval;
+    forceFullScan = false;
+
+    // the regions to search: everything, or around where each blob should be now
+    regions.clear();
+    if (fullScan) {
+        regions.push_back(bounds);
+        framesSinceFullScan = 0;
+        numFullScans++;
+        Metrics::get().add(Metrics::BLOB_FULL_SCANS);
+    } else {
+        for (auto& track : tracks) {
+            cv::Rect predicted = track.rect + cv::Point(track.velocity.x, track.velocity.y);
+            int margin = settings.roiMargin + int(max(fabs(track.velocity.x), fabs(track.velocity.y)));
+            cv::Rect region(predicted.x - margin, predicted.y - margin, predicted.width + margin * 2, predicted.height + margin * 2);
+            region &= bounds;
+            if (region.area() == 0) continue;
+
+            // overlapping regions are merged so a blob is never found twice
+            bool merged = true;
+            while (merged) {
+                merged = false;
+                for (auto it = regions.begin(); it != regions.end(); ++it) {
+                    if ((*it & region).area() > 0) {
+                        region |= *it;
+                        regions.erase(it);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+            regions.push_back(region);
+        }
+        numRoiScans++;
+        Metrics::get().add(Metrics::BLOB_ROI_SCANS);
+    }
+
+    // outside the regions nothing was thresholded
+    if (!fullScan) {
+        job.processed.create(frame.size(), CV_8UC1);
+        job.processed.setTo(0);
+    }
+
+    detections.clear();
+    bool touchedEdge = false;
+    for (auto& region : regions) {
+        scan(frame, job.processed, region, touchedEdge);
+    }
+
+    // label them
+    rects.clear();
+    for (auto& detection : detections) rects.push_back(detection.rect);
+    const vector<unsigned int>& labels = tracker.track(rects);
+
+    job.blobs.resize(detections.size());
+    int numTracks = tracks.size();
+    tracks.resize(detections.size());
+    for (int i = 0; i < detections.size(); i++) {
+        unsigned int label = labels[i];
+        BlobResult& blob = job.blobs[i];
+        blob.index = label;
+        blob.center = detections[i].center;
+        blob.radius = detections[i].radius;
+
+        Track& track = tracks[i];
+        track.label = label;
+        track.rect = detections[i].rect;
+        track.velocity = glm::vec2(0, 0);
+        if (tracker.existsPrevious(label)) {
+            const cv::Rect& previous = tracker.getPrevious(label);
+            track.velocity = glm::vec2(track.rect.x - previous.x, track.rect.y - previous.y);
+        }
+    }
+
+    // a tracked blob that wasn't found, or one that may continue outside its region,
+    // means the regions can't be trusted next frame
+    if (!fullScan && (touchedEdge || (int) detections.size() < numTracks)) forceFullScan = true;
+}
+
+void BlobTracker::scan(const cv::Mat& frame, cv::Mat& processed, const cv::Rect& region, bool& touchedEdge) {
+    cv::Mat source = frame(region);
+    if (processed.size() != frame.size()) processed.create(frame.size(), CV_8UC1);
+    cv::Mat thresholded = processed(region);
+
+    cv::threshold(source, thresholded, settings.thresholdValue, 255, 0);
+    finder.findContours(thresholded);
+
+    cv::Point offset = region.tl();
+    for (int i = 0; i < finder.size(); i++) {
+        Detection detection;
+        detection.rect = finder.getBoundingRect(i) + offset;
+        detection.center = toOf(finder.getMinEnclosingCircle(i, detection.radius)) + glm::vec2(offset.x, offset.y);
+        detections.push_back(detection);
+
+        // touching the frame's own edge is fine, touching a cut through the frame isn't
+        cv::Rect inner = finder.getBoundingRect(i);
+        if ((inner.x <= 0 && region.x > 0) || (inner.y <= 0 && region.y > 0) ||
+            (inner.br().x >= region.width && region.br().x < frame.cols) || (inner.br().y >= region.height && region.br().y < frame.rows)) {
+            touchedEdge = true;
+        }
+    }
+}
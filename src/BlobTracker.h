@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FrameJob.h"
+
+// Blob tracking with stable ids. Blobs are labelled by ofxCv's RectTracker (the tracker
+// inside ContourFinder), so a blob keeps its id from frame to frame instead of taking
+// its index in the contour list. In steady state only a predicted region around each
+// tracked blob is thresholded and searched; the whole frame is scanned every
+// fullScanInterval frames, and on the next frame whenever a track is lost or a blob
+// runs into the edge of its region, so new blobs are still picked up.
+class BlobTracker {
+
+    public:
+        struct Settings {
+            int thresholdValue = 127;
+            float contourThreshold = 2.0;
+            float minAreaRadius = 1.0;
+            float maxAreaRadius = 250.0;
+            int roiMargin = 20; // pixels around the predicted blob that are searched
+            int fullScanInterval = 30; // frames, 1 scans every frame
+            int persistence = 15; // frames a lost blob keeps its id
+            float maxDistance = 64; // pixels a blob may move between frames and keep its id
+        };
+
+        void setup(const Settings& settings);
+
+        // fills job.blobs and job.processed from frame (a pyramid level of the job's frame),
+        // in frame's coordinates
+        void track(const cv::Mat& frame, FrameJob& job);
+
+        uint64_t getNumFullScans() const { return numFullScans.load(); }
+        uint64_t getNumRoiScans() const { return numRoiScans.load(); }
+
+    protected:
+        struct Track {
+            unsigned int label;
+            cv::Rect rect;
+            glm::vec2 velocity;
+        };
+
+        struct Detection {
+            cv::Rect rect;
+            glm::vec2 center;
+            float radius;
+        };
+
+        void scan(const cv::Mat& frame, cv::Mat& processed, const cv::Rect& region, bool& touchedEdge);
+
+        Settings settings;
+        ofxCv::ContourFinder finder;
+        ofxCv::RectTracker tracker;
+
+        // reused every frame
+        vector<Track> tracks;
+        vector<cv::Rect> regions;
+        vector<Detection> detections;
+        vector<cv::Rect> rects;
+
+        int framesSinceFullScan = 0;
+        bool forceFullScan = true;
+        std::atomic<uint64_t> numFullScans { 0 };
+        std::atomic<uint64_t> numRoiScans { 0 };
+
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Fixed-capacity blocking queue connecting two pipeline stages.
+// push() waits for room, tryPush() gives up immediately so a producer that must not
+// stall (capture) can drop instead. close() wakes everyone and makes pop() fail once
+// the queue has drained, which is how stages are shut down.
+template <typename T>
+class BoundedQueue {
+
+    public:
+        explicit BoundedQueue(size_t capacity = 2) : capacity(capacity) { }
+
+        void setCapacity(size_t _capacity) {
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = _capacity;
+        }
+
+        bool push(T value) {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+            if (closed) return false;
+            items.push_back(std::move(value));
+            lock.unlock();
+            notEmpty.notify_one();
+            return true;
+        }
+
+        bool tryPush(T value) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closed || items.size() >= capacity) return false;
+            items.push_back(std::move(value));
+            lock.unlock();
+            notEmpty.notify_one();
+            return true;
+        }
+
+        bool pop(T& value) {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+            if (items.empty()) return false;
+            value = std::move(items.front());
+            items.pop_front();
+            lock.unlock();
+            notFull.notify_one();
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+        void reopen() {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.clear();
+            closed = false;
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return items.size();
+        }
+
+    private:
+        mutable std::mutex mutex;
+        std::condition_variable notEmpty, notFull;
+        std::deque<T> items;
+        size_t capacity;
+        bool closed = false;
+
+};
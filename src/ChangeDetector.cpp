@@ -0,0 +1,89 @@
+#include "ChangeDetector.h"
+
+void ChangeDetector::setup(const Settings& _settings) {
+    settings = _settings;
+    settings.downsample = max(settings.downsample, 1);
+    settings.tileSize = max(settings.tileSize, 1);
+    width = height = 0;
+    hasReference = false;
+    pending = false;
+}
+
+void ChangeDetector::allocate(int _width, int _height) {
+    width = _width;
+    height = _height;
+
+    int smallWidth = max(width / settings.downsample, 1);
+    int smallHeight = max(height / settings.downsample, 1);
+    small.create(smallHeight, smallWidth, CV_8UC1);
+    reference.create(smallHeight, smallWidth, CV_8UC1);
+    diff.create(smallHeight, smallWidth, CV_8UC1);
+
+    tilesX = (smallWidth + settings.tileSize - 1) / settings.tileSize;
+    tilesY = (smallHeight + settings.tileSize - 1) / settings.tileSize;
+    near.assign(tilesX * tilesY, 0);
+
+    hasReference = false;
+    pending = false;
+}
+
+bool ChangeDetector::update(const cv::Mat& frame, const vector<cv::Rect>& results, uint64_t nowMicros) {
+    if (frame.cols != width || frame.rows != height) allocate(frame.cols, frame.rows);
+
+    if (frame.channels() == 1) {
+        cv::resize(frame, small, small.size(), 0, 0, cv::INTER_AREA);
+    } else {
+        cv::resize(frame, smallColor, small.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(smallColor, small, cv::COLOR_RGB2GRAY);
+    }
+
+    bool keepAlive = nowMicros - lastAnalysedMicros >= uint64_t(settings.keepAlive * 1000000);
+    if (!hasReference || keepAlive) {
+        changedTiles = getNumTiles();
+    } else {
+        cv::absdiff(small, reference, diff);
+
+        // tiles touching a previous result
+        std::fill(near.begin(), near.end(), 0);
+        int tilePixels = settings.downsample * settings.tileSize;
+        for (auto& rect : results) {
+            int x0 = max(rect.x / tilePixels, 0);
+            int y0 = max(rect.y / tilePixels, 0);
+            int x1 = min((rect.x + rect.width) / tilePixels, tilesX - 1);
+            int y1 = min((rect.y + rect.height) / tilePixels, tilesY - 1);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) near[y * tilesX + x] = 1;
+            }
+        }
+
+        changedTiles = 0;
+        for (int ty = 0; ty < tilesY && changedTiles < settings.minTiles; ty++) {
+            int rowEnd = min((ty + 1) * settings.tileSize, diff.rows);
+            for (int tx = 0; tx < tilesX && changedTiles < settings.minTiles; tx++) {
+                int colBegin = tx * settings.tileSize;
+                int colEnd = min(colBegin + settings.tileSize, diff.cols);
+                int threshold = near[ty * tilesX + tx] ? settings.nearThreshold : settings.threshold;
+
+                // the tile's largest difference
+                int largest = 0;
+                for (int y = ty * settings.tileSize; y < rowEnd && largest <= threshold; y++) {
+                    const uint8_t* row = diff.ptr<uint8_t>(y);
+                    for (int x = colBegin; x < colEnd; x++) largest = max(largest, int(row[x]));
+                }
+                if (largest > threshold) changedTiles++;
+            }
+        }
+    }
+
+    pending = changedTiles >= settings.minTiles;
+    checkedMicros = nowMicros;
+    return pending;
+}
+
+void ChangeDetector::commit() {
+    if (!pending) return;
+    std::swap(small, reference);
+    hasReference = true;
+    lastAnalysedMicros = checkedMicros;
+    pending = false;
+}
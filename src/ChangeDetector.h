@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+// Cheap frame-difference gate in front of the analyses. The frame is area-downsampled
+// and compared with the last frame that was analysed, tile by tile; a tile has changed
+// when any downsampled pixel in it moved by more than threshold. Tiles touching a
+// previous result (a blob, contour or bright pixel) use the lower nearThreshold, so a
+// tracked marker creeping by a pixel still counts while sensor noise elsewhere doesn't.
+// Unchanged frames aren't analysed or sent, except once every keepAlive seconds.
+class ChangeDetector {
+
+    public:
+        struct Settings {
+            int downsample = 4; // full-frame pixels per downsampled pixel, each way
+            int tileSize = 8; // downsampled pixels per tile, each way
+            int threshold = 8; // gray levels
+            int nearThreshold = 4; // gray levels, for tiles touching a previous result
+            int minTiles = 1; // changed tiles needed for the frame to count as changed
+            float keepAlive = 1.0; // seconds between analyses of an unchanged scene
+        };
+
+        void setup(const Settings& settings);
+
+        // results are full-frame rectangles around the previous frame's results.
+        // Returns true if the frame should be analysed. The frame only becomes the new
+        // reference on commit(), once it's actually on its way to analysis; a changed frame
+        // that gets dropped leaves the reference alone, so the next frame still sees the change.
+        bool update(const cv::Mat& frame, const vector<cv::Rect>& results, uint64_t nowMicros);
+        // makes the frame of the last update() that returned true the reference
+        void commit();
+
+        int getChangedTiles() const { return changedTiles; } // counting stops at minTiles
+        int getNumTiles() const { return tilesX * tilesY; }
+
+    protected:
+        void allocate(int width, int height); // on the first frame and whenever the size changes
+
+        Settings settings;
+        int width = 0, height = 0;
+        int tilesX = 0, tilesY = 0;
+
+        // reused every frame
+        cv::Mat small, smallColor, reference, diff;
+        vector<uint8_t> near;
+
+        bool hasReference = false;
+        uint64_t lastAnalysedMicros = 0;
+        uint64_t checkedMicros = 0; // of the frame in small
+        bool pending = false; // small holds a changed frame that commit() can take
+        int changedTiles = 0;
+
+};
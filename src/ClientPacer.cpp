@@ -0,0 +1,94 @@
+#include "ClientPacer.h"
+
+#define PACER_WINDOW_MICROS 1000000
+#define PACER_CLEAN_WINDOWS_TO_STEP_UP 3
+#define PACER_FRAMERATE_STEPS 2 // halvings of the frame rate below the lowest quality
+
+void ClientPacer::setup(int _maxFramerate, int maxKbps, const vector<int>& _qualities) {
+    maxFramerate = max(_maxFramerate, 1);
+    maxBytesPerSecond = maxKbps > 0 ? uint64_t(maxKbps) * 1000 / 8 : 0;
+    qualities = _qualities;
+    if (qualities.empty()) qualities.push_back(50);
+    numLevels = qualities.size() + PACER_FRAMERATE_STEPS;
+    level = 0;
+}
+
+int ClientPacer::getQuality() const {
+    return qualities[min(level, (int) qualities.size() - 1)];
+}
+
+int ClientPacer::getFramerate() const {
+    int halvings = max(level - (int) qualities.size() + 1, 0);
+    return max(maxFramerate >> halvings, 1);
+}
+
+bool ClientPacer::shouldSend(uint64_t nowMicros) {
+    // a client held back by the bitrate cap sends nothing, so roll the window here too
+    if (windowStart != 0 && nowMicros - windowStart >= PACER_WINDOW_MICROS) update(nowMicros, 0);
+
+    if (nowMicros - lastSendMicros < uint64_t(1000000 / getFramerate())) return false;
+    if (maxBytesPerSecond > 0 && windowBytes >= maxBytesPerSecond) {
+        windowCapped = true; // smaller frames would fit more of them under the cap
+        return false;
+    }
+    lastSendMicros = nowMicros;
+    return true;
+}
+
+void ClientPacer::onQueued(size_t bytes) {
+    queuedBytes += bytes;
+}
+
+void ClientPacer::onSent(size_t bytes, uint64_t latencyMicros) {
+    queuedBytes -= min<uint64_t>(bytes, queuedBytes);
+    sentFrames++;
+    windowBytes += bytes;
+    windowFrames++;
+    windowMaxLatency = max(windowMaxLatency, latencyMicros);
+    latencyMillis = ofLerp(latencyMillis, latencyMicros / 1000.0, 0.1);
+}
+
+void ClientPacer::onDropped(size_t bytes) {
+    queuedBytes -= min<uint64_t>(bytes, queuedBytes);
+    droppedFrames++;
+    windowDrops++;
+}
+
+void ClientPacer::update(uint64_t nowMicros, int queueDepth) {
+    windowMaxDepth = max(windowMaxDepth, queueDepth);
+
+    if (windowStart == 0) windowStart = nowMicros;
+    uint64_t elapsed = nowMicros - windowStart;
+    if (elapsed < PACER_WINDOW_MICROS) return;
+
+    fps = windowFrames * 1000000.0 / elapsed;
+
+    uint64_t frameInterval = 1000000 / getFramerate();
+    bool behind = windowDrops > 0 || windowMaxDepth > 1 || windowMaxLatency > frameInterval || windowCapped;
+
+    if (behind) {
+        level = min(level + 1, numLevels - 1);
+        cleanWindows = 0;
+    } else if (++cleanWindows >= PACER_CLEAN_WINDOWS_TO_STEP_UP) {
+        level = max(level - 1, 0);
+        cleanWindows = 0;
+    }
+
+    windowStart = nowMicros;
+    windowBytes = 0;
+    windowFrames = 0;
+    windowDrops = 0;
+    windowMaxDepth = 0;
+    windowMaxLatency = 0;
+    windowCapped = false;
+}
+
+void ClientPacer::fillStats(ClientStats& stats) const {
+    stats.queuedBytes = queuedBytes;
+    stats.sentFrames = sentFrames;
+    stats.droppedFrames = droppedFrames;
+    stats.fps = fps;
+    stats.latencyMillis = latencyMillis;
+    stats.quality = getQuality();
+    stats.framerate = getFramerate();
+}
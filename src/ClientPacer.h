@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+
+struct ClientStats {
+    string transport; // "mjpeg" or "ws"
+    string address;
+    int queuedFrames = 0;
+    uint64_t queuedBytes = 0;
+    uint64_t sentFrames = 0;
+    uint64_t droppedFrames = 0;
+    float fps = 0; // frames actually delivered per second
+    float latencyMillis = 0; // time for a frame to leave the socket
+    int quality = 0;
+    int framerate = 0; // current cap
+};
+
+// Per-client rate control for the streaming servers. Each client sits on a ladder of
+// levels; the top level is full jpeg quality at max_stream_framerate, lower levels first
+// drop the quality, then halve the frame rate. Once a second the client steps down if it
+// dropped frames, kept a backlog or took longer than a frame interval to send, and steps
+// back up after a few clean seconds. Not thread-safe, the owner locks around it.
+class ClientPacer {
+
+    public:
+        void setup(int maxFramerate, int maxKbps, const vector<int>& qualities);
+
+        // false if this frame would go over the client's frame rate or bitrate
+        bool shouldSend(uint64_t nowMicros);
+
+        void onQueued(size_t bytes);
+        void onSent(size_t bytes, uint64_t latencyMicros);
+        void onDropped(size_t bytes);
+
+        // call after every send; steps the level at most once a second
+        void update(uint64_t nowMicros, int queueDepth);
+
+        int getQuality() const;
+        int getFramerate() const;
+        void fillStats(ClientStats& stats) const;
+
+    protected:
+        vector<int> qualities;
+        int maxFramerate = 30;
+        uint64_t maxBytesPerSecond = 0; // 0 for no limit
+        int level = 0;
+        int numLevels = 1;
+
+        uint64_t lastSendMicros = 0;
+        uint64_t queuedBytes = 0;
+        uint64_t sentFrames = 0;
+        uint64_t droppedFrames = 0;
+
+        // current one second window
+        uint64_t windowStart = 0;
+        uint64_t windowBytes = 0;
+        int windowFrames = 0;
+        int windowDrops = 0;
+        int windowMaxDepth = 0;
+        uint64_t windowMaxLatency = 0;
+        bool windowCapped = false;
+        int cleanWindows = 0;
+
+        float fps = 0;
+        float latencyMillis = 0;
+
+};
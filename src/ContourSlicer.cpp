@@ -0,0 +1,208 @@
+#include "ContourSlicer.h"
+#include "Metrics.h"
+
+using namespace ofxCv;
+
+#define SLICE_ARENA_SIZE (64 * 1024) // grows to what a frame needs
+
+// ~ ~ ~ POLYLINES ~ ~ ~
+// ofPolyline's Douglas-Peucker and smoothing, without its temporary polylines
+
+static inline float distanceSquared(const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 d = a - b;
+    return glm::dot(d, d);
+}
+
+static void simplifyDP(float tolSquared, const glm::vec3* v, int j, int k, int* marks) {
+    if (k <= j + 1) return;
+
+    int maxi = j;
+    float maxd2 = 0;
+    glm::vec3 u = v[k] - v[j];
+    float cu = glm::dot(u, u);
+    for (int i = j + 1; i < k; i++) {
+        glm::vec3 w = v[i] - v[j];
+        float cw = glm::dot(w, u);
+        float dv2;
+        if (cw <= 0) {
+            dv2 = distanceSquared(v[i], v[j]);
+        } else if (cu <= cw) {
+            dv2 = distanceSquared(v[i], v[k]);
+        } else {
+            dv2 = distanceSquared(v[i], v[j] + u * (cw / cu));
+        }
+        if (dv2 <= maxd2) continue;
+        maxi = i;
+        maxd2 = dv2;
+    }
+
+    if (maxd2 > tolSquared) {
+        marks[maxi] = 1;
+        simplifyDP(tolSquared, v, j, maxi, marks);
+        simplifyDP(tolSquared, v, maxi, k, marks);
+    }
+}
+
+// in place, returns the new number of points
+static int simplifyPolyline(glm::vec3* points, int n, float tolerance, FrameArena& arena) {
+    if (n < 2) return n;
+    float tolSquared = tolerance * tolerance;
+
+    // vertex reduction within tolerance of the last kept vertex, writing behind the reader
+    glm::vec3 kept = points[0];
+    int k = 1;
+    bool keptLast = false;
+    for (int i = 1; i < n; i++) {
+        if (distanceSquared(points[i], kept) < tolSquared) {
+            keptLast = false;
+            continue;
+        }
+        kept = points[i];
+        points[k++] = kept;
+        keptLast = true;
+    }
+    if (!keptLast) points[k++] = points[n - 1];
+
+    int* marks = arena.allocate<int>(k);
+    std::fill(marks, marks + k, 0);
+    marks[0] = marks[k - 1] = 1;
+    simplifyDP(tolSquared, points, 0, k - 1, marks);
+
+    int m = 0;
+    for (int i = 0; i < k; i++) {
+        if (marks[i]) points[m++] = points[i];
+    }
+    return m;
+}
+
+// closed polyline, as ofPolyline::getSmoothed(size, shape)
+static void smoothClosedPolyline(const glm::vec3* points, glm::vec3* smoothed, int n, int size, float shape, FrameArena& arena) {
+    size = ofClamp(size, 0, n);
+    shape = ofClamp(shape, 0, 1);
+
+    float* weights = arena.allocate<float>(max(size, 1));
+    for (int i = 1; i < size; i++) weights[i] = ofMap(i, 0, size, 1, shape);
+
+    for (int i = 0; i < n; i++) {
+        glm::vec3 result = points[i];
+        float sum = 1; // center weight
+        for (int j = 1; j < size; j++) {
+            glm::vec3 cur(0, 0, 0);
+            int left = i - j;
+            int right = i + j;
+            if (left < 0) left += n;
+            if (left >= 0) {
+                cur += points[left];
+                sum += weights[j];
+            }
+            if (right >= n) right -= n;
+            if (right < n) {
+                cur += points[right];
+                sum += weights[j];
+            }
+            result += cur * weights[j];
+        }
+        smoothed[i] = result / sum;
+    }
+}
+
+void ContourSlicer::setup(int contourSlices, float minAreaRadius, float maxAreaRadius, float _simplify, int _smooth, int numThreads) {
+    simplify = _simplify;
+    smooth = _smooth;
+
+    slices.clear();
+    for (int h=0; h<255; h += int(255/contourSlices)) {
+        unique_ptr<Slice> slice(new Slice());
+        slice->threshold = h;
+        slice->finder.setMinAreaRadius(minAreaRadius);
+        slice->finder.setMaxAreaRadius(maxAreaRadius);
+        slice->finder.setThreshold(h);
+        slice->arena.setup(SLICE_ARENA_SIZE);
+        slices.push_back(std::move(slice));
+    }
+
+    // the calling thread works too, so one less than asked for
+    workers.setup(max(numThreads - 1, 0));
+}
+
+void ContourSlicer::stop() {
+    workers.stop();
+}
+
+float ContourSlicer::getAverageSliceMicros(int slice) const {
+    return slices[slice]->averageMicros.load();
+}
+
+void ContourSlicer::find(FrameJob& job, const cv::Mat& frame) {
+    int numSlices = slices.size();
+    int wanted = job.plan.contourSlices > 0 ? min(job.plan.contourSlices, numSlices) : numSlices;
+    int stride = (numSlices + wanted - 1) / max(wanted, 1);
+
+    tasks.clear();
+    for (int i = 0; i < numSlices; i += stride) {
+        Slice* s = slices[i].get();
+        tasks.push_back([this, s, &frame]() { findSlice(*s, frame); });
+    }
+    workers.run(tasks);
+
+    uint64_t arenaAllocations = 0, heapAllocations = 0;
+    for (int i = 0; i < numSlices; i += stride) {
+        arenaAllocations += slices[i]->arena.getAllocations();
+        heapAllocations += slices[i]->arena.getHeapAllocations();
+    }
+    Metrics::get().add(Metrics::ARENA_ALLOCATIONS, arenaAllocations);
+    Metrics::get().add(Metrics::ARENA_HEAP_ALLOCATIONS, heapAllocations);
+
+    // stitch together in slice order; swapping hands the point storage back and forth
+    // between the job and the slices, so nothing is reallocated in steady state
+    job.numContours = 0;
+    job.contourSliceMicros.assign(slices.size(), 0);
+    for (int i = 0; i < numSlices; i += stride) {
+        Slice& slice = *slices[i];
+        for (int j = 0; j < slice.numContours; j++) {
+            if (job.numContours >= job.contours.size()) job.contours.emplace_back();
+            ContourResult& contour = job.contours[job.numContours++];
+            std::swap(contour.points, slice.contours[j].points);
+            contour.color = slice.contours[j].color;
+        }
+        job.contourSliceMicros[i] = slice.micros;
+        slice.averageMicros = ofLerp(slice.averageMicros.load(), float(slice.micros), 0.1f);
+    }
+}
+
+void ContourSlicer::findSlice(Slice& slice, const cv::Mat& frame) {
+    uint64_t start = ofGetElapsedTimeMicros();
+    slice.arena.reset();
+
+    int channels = frame.channels();
+
+    slice.finder.findContours(frame);
+
+    int n = slice.finder.size();
+    slice.numContours = 0;
+    for (int i = 0; i < n; i++) {
+        const vector<cv::Point>& found = slice.finder.getContour(i);
+        int count = found.size();
+        if (count == 0) continue;
+
+        glm::vec3* points = slice.arena.allocate<glm::vec3>(count);
+        for (int j = 0; j < count; j++) points[j] = glm::vec3(found[j].x, found[j].y, 0);
+        count = simplifyPolyline(points, count, simplify, slice.arena);
+        glm::vec3* smoothed = slice.arena.allocate<glm::vec3>(count);
+        smoothClosedPolyline(points, smoothed, count, smooth, 0.5, slice.arena);
+
+        // only reallocates when this slot sees its biggest contour yet
+        if (slice.numContours >= slice.contours.size()) slice.contours.emplace_back();
+        ContourResult& contour = slice.contours[slice.numContours++];
+        contour.points.assign(smoothed, smoothed + count);
+
+        int x = int(contour.points[0].x);
+        int y = int(contour.points[0].y);
+        contour.color = frame.ptr<uint8_t>(y)[x * channels];
+
+        float z = contour.color.getBrightness();
+        for (auto& point : contour.points) point.z = z;
+    }
+
+    slice.micros = ofGetElapsedTimeMicros() - start;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FrameJob.h"
+#include "WorkerPool.h"
+#include "FrameArena.h"
+
+// Multi-level contour extraction. Every threshold slice gets its own ContourFinder and
+// the slices run concurrently on a worker pool, then the results are stitched back
+// together in slice order, so the output is identical to running the slices one after
+// another on a single finder. Each contour is simplified and smoothed in scratch memory
+// from the slice's FrameArena, with the same results as ofPolyline::simplify() and
+// getSmoothed(), and only the finished points are copied out.
+class ContourSlicer {
+
+    public:
+        void setup(int contourSlices, float minAreaRadius, float maxAreaRadius, float simplify, int smooth, int numThreads);
+        void stop();
+
+        // fills job.contours / job.numContours and job.contourSliceMicros, in the coordinates
+        // of frame (a pyramid level of the job's frame). Under load the scheduler may ask for
+        // fewer slices (job.plan.contourSlices), spread evenly over the thresholds.
+        void find(FrameJob& job, const cv::Mat& frame);
+
+        int getNumSlices() const { return slices.size(); }
+        // running average of how long each slice takes, in microseconds
+        float getAverageSliceMicros(int slice) const;
+
+    protected:
+        struct Slice {
+            int threshold;
+            ofxCv::ContourFinder finder;
+            vector<ContourResult> contours;
+            int numContours = 0;
+            uint64_t micros = 0;
+            std::atomic<float> averageMicros { 0 }; // written by the analyze thread, read by draw()
+            FrameArena arena; // reset at the start of every frame
+        };
+
+        void findSlice(Slice& slice, const cv::Mat& frame);
+
+        vector<unique_ptr<Slice>> slices;
+        float simplify = 0.5;
+        int smooth = 2;
+
+        WorkerPool workers;
+        vector<std::function<void()>> tasks;
+
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FrameBuffer.h"
+
+// One captured camera frame, as handed from the capture thread to consumers.
+// Consumers that keep the pixels past the next frame hold on to buffer instead of copying.
+struct Frame {
+    shared_ptr<FrameBuffer> buffer;
+    cv::Mat mat; // view of buffer
+    uint64_t seq = 0; // increments for every frame the camera delivers, including dropped ones
+    int timestamp = 0;
+    uint64_t grabMicros = 0; // ofGetElapsedTimeMicros() when the frame was grabbed
+};
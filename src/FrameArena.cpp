@@ -0,0 +1,43 @@
+#include "FrameArena.h"
+
+void FrameArena::setup(size_t _capacity) {
+    capacity = _capacity;
+    block.reset(capacity > 0 ? new char[capacity] : nullptr);
+    overflow.clear();
+    used = 0;
+    requested = 0;
+}
+
+void FrameArena::reset() {
+    allocations = 0;
+    heapAllocations = 0;
+    overflow.clear();
+
+    if (requested > capacity) {
+        // room for this much again, and some more
+        capacity = requested + requested / 2;
+        block.reset(new char[capacity]);
+        heapAllocations++;
+    }
+    used = 0;
+    requested = 0;
+}
+
+void* FrameArena::allocateBytes(size_t bytes, size_t alignment) {
+    allocations++;
+
+    // new[] is aligned for any fundamental type, so aligning the offset aligns the pointer
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    requested += offset - used + bytes;
+    if (offset + bytes <= capacity) {
+        used = offset + bytes;
+        return block.get() + offset;
+    }
+
+    // out of room until the next reset
+    used = capacity;
+    heapAllocations++;
+    overflow.emplace_back(new char[bytes + alignment]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(overflow.back().get());
+    return reinterpret_cast<void*>((address + alignment - 1) & ~uintptr_t(alignment - 1));
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+// Bump allocator for scratch memory that only lives for one frame. allocate() hands out
+// the next aligned piece of one preallocated block, reset() takes it all back at once,
+// and nothing is ever freed or destructed individually. If a frame needs more than the
+// block holds, the extra comes from the heap and the block grows at the next reset to
+// the frame's total, so after a few frames every allocation is a pointer bump.
+// Not thread-safe, one per thread.
+class FrameArena {
+
+    public:
+        void setup(size_t capacity);
+
+        // uninitialized storage for count Ts
+        template <typename T>
+        T* allocate(size_t count) {
+            static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destructed");
+            return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+        }
+
+        void reset();
+
+        size_t getCapacity() const { return capacity; }
+        // since the last reset
+        uint64_t getAllocations() const { return allocations; }
+        uint64_t getHeapAllocations() const { return heapAllocations; } // overflow, or the block growing
+
+    protected:
+        void* allocateBytes(size_t bytes, size_t alignment);
+
+        std::unique_ptr<char[]> block;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t requested = 0; // including overflow, what the block needs to hold this frame
+        std::vector<std::unique_ptr<char[]>> overflow;
+
+        uint64_t allocations = 0;
+        uint64_t heapAllocations = 0;
+
+};
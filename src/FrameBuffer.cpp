@@ -0,0 +1,27 @@
+#include "FrameBuffer.h"
+
+FrameBuffer::FrameBuffer(int width, int height, int channels) {
+    mat.create(height, width, CV_8UC(channels));
+    pixels.setFromExternalPixels(mat.ptr<unsigned char>(), width, height, channels);
+}
+
+void FramePool::setup(int _width, int _height, int _channels, int size) {
+    width = _width;
+    height = _height;
+    channels = _channels;
+
+    buffers.clear();
+    for (int i = 0; i < size; i++) {
+        buffers.push_back(make_shared<FrameBuffer>(width, height, channels));
+    }
+}
+
+shared_ptr<FrameBuffer> FramePool::acquire() {
+    for (auto& buffer : buffers) {
+        if (buffer.use_count() == 1) return buffer;
+    }
+
+    buffers.push_back(make_shared<FrameBuffer>(width, height, channels));
+    ofLogVerbose("FramePool") << "grew to " << buffers.size() << " buffers";
+    return buffers.back();
+}
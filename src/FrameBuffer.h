@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+// One frame's worth of pixel memory, allocated once and recycled through a FramePool.
+// mat and pixels are two views of the same bytes, so OpenCV and openFrameworks code can
+// both use a frame without either copying it. Holders share a buffer through shared_ptr;
+// it goes back to the pool when the last of them lets go.
+class FrameBuffer {
+
+    public:
+        FrameBuffer(int width, int height, int channels);
+
+        cv::Mat mat;
+        ofPixels pixels; // external, points into mat
+
+        int getWidth() const { return mat.cols; }
+        int getHeight() const { return mat.rows; }
+        int getChannels() const { return mat.channels(); }
+
+};
+
+// Pool of same-sized frame buffers. A buffer is free when the pool holds the only
+// reference to it. If every buffer is in use the pool grows by one, which only happens
+// until it has as many as the pipeline can hold at once; after that nothing allocates.
+// Not thread-safe, acquire from one thread; the buffers themselves can go anywhere.
+class FramePool {
+
+    public:
+        void setup(int width, int height, int channels, int size);
+
+        shared_ptr<FrameBuffer> acquire();
+
+        int getSize() const { return buffers.size(); }
+
+    protected:
+        int width = 0, height = 0, channels = 1;
+        vector<shared_ptr<FrameBuffer>> buffers;
+
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Raw frame dump file, read by RawDumpSource through mmap. Little-endian, native layout.
+//
+//   FrameDumpHeader   64 bytes
+//   numFrames records of recordSize() bytes each:
+//     FrameDumpRecord   32 bytes
+//     pixels            width * height * channels, rows packed, then padding to 64 bytes
+//
+// The records form a ring: the oldest frame is record `first`, and playback wraps
+// around to record 0 after the last one. A plain dump has first = 0.
+struct FrameDumpRecord {
+    uint64_t seq;
+    int64_t timestamp; // as Frame::timestamp
+    uint64_t grabMicros;
+    uint64_t reserved;
+};
+
+struct FrameDumpHeader {
+    char magic[4]; // "PFD1"
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels; // 1 gray, 3 color
+    uint32_t numFrames; // records in use
+    uint32_t capacity; // records the file has room for
+    uint32_t first; // record holding the oldest frame
+    uint32_t reserved[9];
+
+    void init(uint32_t _width, uint32_t _height, uint32_t _channels, uint32_t _capacity) {
+        memset(this, 0, sizeof(FrameDumpHeader));
+        memcpy(magic, "PFD1", 4);
+        width = _width;
+        height = _height;
+        channels = _channels;
+        capacity = _capacity;
+    }
+
+    bool isValid() const {
+        return memcmp(magic, "PFD1", 4) == 0 && width > 0 && height > 0 && (channels == 1 || channels == 3) && numFrames <= capacity && (numFrames == 0 || first < numFrames);
+    }
+
+    size_t frameBytes() const { return size_t(width) * height * channels; }
+
+    size_t recordSize() const {
+        size_t size = sizeof(FrameDumpRecord) + frameBytes();
+        return (size + 63) & ~size_t(63);
+    }
+
+    size_t fileSize() const { return sizeof(FrameDumpHeader) + recordSize() * capacity; }
+
+    size_t recordOffset(uint32_t index) const { return sizeof(FrameDumpHeader) + recordSize() * index; }
+};
+
+static_assert(sizeof(FrameDumpHeader) == 64, "FrameDumpHeader must stay 64 bytes");
+static_assert(sizeof(FrameDumpRecord) == 32, "FrameDumpRecord must stay 32 bytes");
@@ -0,0 +1,83 @@
+#include "FrameGrabber.h"
+#include "Metrics.h"
+
+#define GRABBER_POOL_SIZE 16 // three slots, every job the pipeline can hold and the pre-roll writer's queue
+
+void FrameGrabber::setup(FrameSource& _source, int width, int height, int _framerate, bool color, std::function<int()> _timestampFunction, bool _lossless) {
+    source = &_source;
+    framerate = max(_framerate, 0);
+    timestampFunction = _timestampFunction;
+    lossless = _lossless;
+
+    // preallocate so sources never reallocate in steady state
+    pool.setup(width, height, color ? 3 : 1, GRABBER_POOL_SIZE);
+    for (int i = 0; i < 3; i++) {
+        Frame& frame = slots.slot(i);
+        frame.buffer = pool.acquire();
+        frame.mat = frame.buffer->mat;
+    }
+}
+
+void FrameGrabber::start() {
+    startThread();
+}
+
+void FrameGrabber::stop() {
+    waitForThread(true);
+}
+
+bool FrameGrabber::getLatest(Frame*& frame) {
+    if (!slots.consume()) return false;
+    frame = &slots.front();
+    return true;
+}
+
+bool FrameGrabber::waitForLatest(Frame*& frame, int timeoutMillis) {
+    if (getLatest(frame)) return true;
+    {
+        std::unique_lock<std::mutex> lock(arrivedMutex);
+        arrived.wait_for(lock, std::chrono::milliseconds(timeoutMillis));
+    }
+    return getLatest(frame);
+}
+
+void FrameGrabber::threadedFunction() {
+    uint64_t framePeriod = framerate > 0 ? 1000000 / framerate : 0;
+
+    while (isThreadRunning()) {
+        uint64_t start = ofGetElapsedTimeMicros();
+
+        // the back slot is ours until publish(), so the source can write straight into it,
+        // unless a consumer still holds its buffer. The pool and this slot account for two references
+        Frame& frame = slots.back();
+        if (frame.buffer.use_count() > 2) {
+            frame.buffer = pool.acquire();
+            frame.mat = frame.buffer->mat;
+        }
+
+        if (source->grab(frame.mat)) {
+            Metrics::get().record(Metrics::CAPTURE, ofGetElapsedTimeMicros() - start);
+            Metrics::get().add(Metrics::FRAMES_GRABBED);
+            frame.seq = framesGrabbed.fetch_add(1) + 1;
+            if (!source->getTimestamp(frame.timestamp)) frame.timestamp = timestampFunction ? timestampFunction() : 0;
+            frame.grabMicros = start;
+
+            while (lossless && slots.isPending() && isThreadRunning()) ofSleepMillis(1);
+
+            if (slots.publish()) {
+                framesDropped++;
+                Metrics::get().add(Metrics::DROPPED_GRABBER);
+            }
+            arrived.notify_one();
+        } else if (source->isFinished()) {
+            finished = true;
+            break;
+        } else if (framePeriod == 0) {
+            ofSleepMillis(1); // nothing there yet, don't spin
+        }
+
+        // the source delivers at the frame rate, so there is nothing new to grab before then
+        uint64_t elapsed = ofGetElapsedTimeMicros() - start;
+        if (elapsed < framePeriod) ofSleepMillis((framePeriod - elapsed) / 1000);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "Frame.h"
+#include "FrameBuffer.h"
+#include "FrameSource.h"
+#include "TripleBuffer.h"
+
+// Grabs from the frame source on its own thread so capture keeps pace with cam_framerate
+// no matter how long the main loop spends on analysis. Frames land in three slots
+// and the newest one is handed over through a lock-free triple buffer; if the consumer
+// falls behind, stale frames are overwritten, never queued. Each slot's pixels live in a
+// pooled FrameBuffer, so a consumer can keep a frame by sharing its buffer, and the slot
+// moves on to a free one.
+class FrameGrabber : public ofThread {
+
+    public:
+        // framerate 0 grabs as fast as the source delivers. Lossless waits for the consumer to
+        // take every frame instead of overwriting it, for replaying footage frame by frame
+        void setup(FrameSource& source, int width, int height, int framerate, bool color, std::function<int()> timestampFunction, bool lossless = false);
+        void start();
+        void stop();
+
+        // consumer thread only; returns true and points frame at the newest slot if one arrived since the last call.
+        // The slot stays valid until the next call to getLatest.
+        bool getLatest(Frame*& frame);
+        // as getLatest, but sleeps up to timeoutMillis for the next frame
+        bool waitForLatest(Frame*& frame, int timeoutMillis);
+
+        uint64_t getFramesGrabbed() const { return framesGrabbed.load(); }
+        uint64_t getFramesDropped() const { return framesDropped.load(); }
+        bool isFinished() const { return finished.load(); } // a replay source that doesn't loop ran out
+
+    protected:
+        void threadedFunction() override;
+
+        FrameSource* source = nullptr;
+        int framerate = 30;
+        bool lossless = false;
+        std::function<int()> timestampFunction;
+
+        TripleBuffer<Frame> slots;
+        FramePool pool; // capture thread only, once set up
+        std::mutex arrivedMutex; // only for waking the consumer, the handoff itself is lock-free
+        std::condition_variable arrived;
+        std::atomic<uint64_t> framesGrabbed { 0 };
+        std::atomic<uint64_t> framesDropped { 0 };
+        std::atomic<bool> finished { false };
+
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "PeakFinder.h"
+#include "FrameBuffer.h"
+#include "FrameScheduler.h"
+#include "ProcessingPyramid.h"
+
+struct BlobResult {
+    int index;
+    glm::vec2 center;
+    float radius;
+};
+
+struct ContourResult {
+    vector<glm::vec3> points; // simplified + smoothed, z holds the sampled brightness
+    ofColor color;
+    ofBuffer colorBuffer; // packed by the serialize stage
+    ofBuffer pointsBuffer;
+};
+
+struct PixelResult {
+    float x = 0;
+    float y = 0;
+    float brightness = 0;
+};
+
+// Everything the pipeline knows about one frame. Jobs are pooled and recycled,
+// so the containers keep their capacity from frame to frame.
+struct FrameJob {
+    uint64_t seq = 0;
+    int timestamp = 0;
+    uint64_t grabMicros = 0;
+    uint64_t analyzeMicros = 0; // when the analyses started, for the scheduler's budget
+
+    FrameScheduler::Plan plan; // which analyses run on this frame, and how much of them
+
+    shared_ptr<FrameBuffer> buffer; // the grabbed frame, shared with the grabber rather than copied
+    cv::Mat frame; // view of buffer, read only
+    ProcessingPyramid pyramid; // what the analyses look at, built from frame by the analyze stage
+    cv::Mat processed; // thresholded pyramid level the blobs were found in
+    ofPixels pixels; // view of buffer, read only
+
+    bool hasBlobs = false;
+    bool hasContours = false;
+    bool hasPixel = false;
+    bool hasVideo = false;
+
+    vector<BlobResult> blobs;
+    vector<ContourResult> contours;
+    int numContours = 0; // contours is never shrunk, only the first numContours are valid
+    vector<uint64_t> contourSliceMicros; // time spent on each threshold slice
+    PixelResult pixel;
+    vector<PeakFinder::Peak> peaks; // only when brightest_pixel_peaks > 1
+    shared_ptr<const ofBuffer> video; // sync video thumbnail, shared with the JpegCache
+};
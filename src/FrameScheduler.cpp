@@ -0,0 +1,108 @@
+#include "FrameScheduler.h"
+
+#define SCHEDULER_SETTLE_FRAMES 5 // frames between steps up, so a step shows in the average first
+#define SCHEDULER_CALM_FRAMES 30 // frames well under budget before stepping back down
+#define SCHEDULER_CALM_RATIO 0.7 // of the budget
+
+void FrameScheduler::setup(const Settings& _settings) {
+    settings = _settings;
+    settings.contourSlices = max(settings.contourSlices, 1);
+
+    for (int i = 0; i < NUM_FEATURES; i++) credit[i] = 1; // everything runs on the first frame
+    lastPlanMicros = 0;
+    level = 0;
+    averageMicros = 0;
+    framesSinceStep = 0;
+    calmFrames = 0;
+
+    // the ladder: enabled features from lowest priority up, leaving out the highest
+    steps.clear();
+    vector<Feature> order;
+    int topPriority = INT_MIN;
+    for (int i = 0; i < NUM_FEATURES; i++) {
+        if (!settings.features[i].enabled) continue;
+        order.push_back(Feature(i));
+        topPriority = max(topPriority, settings.features[i].priority);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](Feature a, Feature b) {
+        return settings.features[a].priority < settings.features[b].priority;
+    });
+
+    for (Feature feature : order) {
+        if (settings.features[feature].priority == topPriority) break;
+        Step step;
+        step.feature = feature;
+        if (feature == CONTOURS) {
+            for (int slices = settings.contourSlices / 2; slices >= 1; slices /= 2) {
+                step.contourSlices = slices;
+                steps.push_back(step);
+            }
+        } else if (feature == SYNC_VIDEO) {
+            for (int drop = 1; drop <= settings.videoQualitySteps; drop++) {
+                step.videoQualityDrop = drop;
+                steps.push_back(step);
+            }
+        }
+        step.skip = true;
+        steps.push_back(step);
+    }
+}
+
+void FrameScheduler::plan(uint64_t nowMicros, Plan& plan) {
+    float elapsed = lastPlanMicros > 0 ? (nowMicros - lastPlanMicros) / 1000000.0f : 0;
+    lastPlanMicros = nowMicros;
+
+    for (int i = 0; i < NUM_FEATURES; i++) {
+        const FeatureSettings& feature = settings.features[i];
+        plan.run[i] = feature.enabled;
+        plan.due[i] = false;
+        if (!feature.enabled || feature.rate <= 0) continue;
+
+        // due on this frame if it's nearer to the due time than the next frame will be
+        float step = feature.rate * elapsed;
+        credit[i] = min(credit[i] + step, 1.0f);
+        plan.due[i] = credit[i] >= 1 - step / 2;
+        plan.run[i] = plan.due[i];
+    }
+
+    plan.contourSlices = 0;
+    plan.videoQualityDrop = 0;
+    plan.shedLevel = level.load();
+    for (int i = 0; i < plan.shedLevel && i < int(steps.size()); i++) {
+        const Step& step = steps[i];
+        if (step.skip) plan.run[step.feature] = false;
+        if (step.contourSlices > 0) plan.contourSlices = step.contourSlices;
+        if (step.videoQualityDrop > 0) plan.videoQualityDrop = step.videoQualityDrop;
+    }
+}
+
+void FrameScheduler::charge(const Plan& plan) {
+    for (int i = 0; i < NUM_FEATURES; i++) {
+        if (plan.due[i]) credit[i] = max(credit[i] - 1, -1.0f);
+    }
+}
+
+void FrameScheduler::report(uint64_t frameMicros) {
+    float average = averageMicros.load();
+    average = average > 0 ? ofLerp(average, frameMicros, 0.2) : frameMicros;
+    averageMicros = average;
+    if (!settings.loadShedding) return;
+
+    float budget = settings.budgetMillis * 1000;
+    framesSinceStep++;
+    if (average > budget) {
+        calmFrames = 0;
+        if (framesSinceStep >= SCHEDULER_SETTLE_FRAMES && level < int(steps.size())) {
+            level++;
+            framesSinceStep = 0;
+        }
+    } else if (average < budget * SCHEDULER_CALM_RATIO) {
+        if (++calmFrames >= SCHEDULER_CALM_FRAMES && level > 0) {
+            level--;
+            calmFrames = 0;
+            framesSinceStep = 0;
+        }
+    } else {
+        calmFrames = 0;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Decides, once per frame, which analyses run on it and how much of each. Every feature
+// has a target rate and a priority. A feature with a rate builds up credit as time passes
+// and runs on the frame closest to when it falls due, so 15 per second of a 30fps camera
+// is every other frame; rate 0 runs on every frame.
+//
+// With load shedding on, the pipeline reports how long each frame took from the start of
+// its analyses to the end of serialization. While the running average is over budget the
+// scheduler steps up a shed level every few frames, each level degrading the lowest
+// priority work that's left: contour slices are halved down to one and then skipped, the
+// sync video thumbnail loses a quality level at a time and then is skipped, brightest
+// pixel and blobs are skipped outright. The highest priority feature is never shed, so
+// its latency stays bounded. After a run of frames well under budget it steps back down.
+class FrameScheduler {
+
+    public:
+        enum Feature {
+            BLOBS,
+            CONTOURS,
+            BRIGHTEST_PIXEL,
+            SYNC_VIDEO,
+            NUM_FEATURES
+        };
+
+        struct FeatureSettings {
+            bool enabled = false;
+            float rate = 0; // per second, 0 for every frame
+            int priority = 0; // higher is shed later
+        };
+
+        struct Settings {
+            FeatureSettings features[NUM_FEATURES];
+            bool loadShedding = false;
+            float budgetMillis = 33; // per frame, analyses + serialization
+            int contourSlices = 10;
+            int videoQualitySteps = 2; // osc_video_quality levels that may be dropped
+        };
+
+        // what runs on one frame; the defaults run everything in full
+        struct Plan {
+            bool run[NUM_FEATURES] = { true, true, true, true };
+            bool due[NUM_FEATURES] = {}; // rate limited features whose credit this frame spends
+            int contourSlices = 0; // 0 for all of them
+            int videoQualityDrop = 0; // osc_video_quality levels below the configured one
+            int shedLevel = 0;
+        };
+
+        void setup(const Settings& settings);
+
+        // convert thread, once per frame that goes to analysis
+        void plan(uint64_t nowMicros, Plan& plan);
+        // convert thread, once the planned frame is queued; a dropped frame leaves its credit
+        // for the next one
+        void charge(const Plan& plan);
+        // serialize thread, once per frame that was planned
+        void report(uint64_t frameMicros);
+
+        int getShedLevel() const { return level.load(); }
+        int getNumShedLevels() const { return steps.size(); }
+        float getAverageFrameMillis() const { return averageMicros.load() / 1000; }
+
+    protected:
+        // one shed level: a feature either gets cheaper or is skipped
+        struct Step {
+            Feature feature;
+            int contourSlices = 0;
+            int videoQualityDrop = 0;
+            bool skip = false;
+        };
+
+        Settings settings;
+        vector<Step> steps; // shed level n applies the first n
+
+        // convert thread only
+        float credit[NUM_FEATURES];
+        uint64_t lastPlanMicros = 0;
+
+        // serialize thread writes, the others read
+        std::atomic<int> level { 0 };
+        std::atomic<float> averageMicros { 0 };
+        int framesSinceStep = 0;
+        int calmFrames = 0;
+
+};
@@ -0,0 +1,25 @@
+#include "FrameSource.h"
+
+bool ReplaySource::getTimestamp(int& timestamp) const {
+    float framerate = getFramerate() > 0 ? getFramerate() : 30;
+    timestamp = int((frameIndex - 1) * 1000 / framerate);
+    return true;
+}
+
+void ReplaySource::fit(const cv::Mat& decoded, cv::Mat& frame) const {
+    const cv::Mat* image = &decoded;
+    cv::Mat converted;
+
+    int channels = color ? 3 : 1;
+    if (decoded.channels() != channels) {
+        if (channels == 1) cv::cvtColor(decoded, converted, decoded.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        else cv::cvtColor(decoded, converted, decoded.channels() == 4 ? cv::COLOR_BGRA2BGR : cv::COLOR_GRAY2BGR);
+        image = &converted;
+    }
+
+    if (image->cols != frame.cols || image->rows != frame.rows) {
+        cv::resize(*image, frame, frame.size(), 0, 0, cv::INTER_AREA);
+    } else {
+        image->copyTo(frame);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+// Where FrameGrabber gets its frames from: the Pi camera, or footage replayed from disk
+// so the vision and streaming paths can run, be profiled and be compared on machines
+// without a camera. Picked with <source> in settings.xml.
+//
+// grab() is only ever called from the grabber thread, so sources needn't be thread-safe.
+class FrameSource {
+
+    public:
+        virtual ~FrameSource() { }
+
+        // frames come out width x height, CV_8UC3 if color else CV_8UC1
+        virtual bool setup(int width, int height, bool color) = 0;
+        virtual void close() { }
+
+        // copies the next frame into frame, which is already allocated at the right size and type.
+        // Returns false if there is no frame right now, or none left if isFinished()
+        virtual bool grab(cv::Mat& frame) = 0;
+
+        // replay sources stamp frames themselves so runs are repeatable; live sources
+        // return false and the grabber stamps the frame with the wall clock
+        virtual bool getTimestamp(int& timestamp) const { return false; }
+
+        virtual bool isFinished() const { return false; }
+        virtual void setLoop(bool loop) { } // replay sources start over at the end, or finish
+        virtual string getName() const = 0;
+
+        // nominal frames per second, 0 if the source doesn't know
+        virtual float getFramerate() const { return 0; }
+
+};
+
+// Shared by the sources that play footage back: loops or ends, and derives each frame's
+// timestamp from its index so the same footage always gives the same timestamps.
+class ReplaySource : public FrameSource {
+
+    public:
+        void setLoop(bool _loop) override { loop = _loop; }
+
+        bool getTimestamp(int& timestamp) const override;
+        bool isFinished() const override { return finished; }
+
+    protected:
+        // call once per delivered frame
+        void advance() { frameIndex++; }
+        // fits a decoded image into the output size and type
+        void fit(const cv::Mat& decoded, cv::Mat& frame) const;
+
+        int width = 640;
+        int height = 480;
+        bool color = false;
+        bool loop = true;
+        bool finished = false;
+        uint64_t frameIndex = 0; // keeps counting across loops so timestamps never go backwards
+
+};
@@ -0,0 +1,48 @@
+#include "ImageSequenceSource.h"
+
+bool ImageSequenceSource::setup(int _width, int _height, bool _color) {
+    width = _width;
+    height = _height;
+    color = _color;
+
+    ofDirectory dir(ofToDataPath(path, true));
+    dir.allowExt("png");
+    dir.allowExt("jpg");
+    dir.allowExt("jpeg");
+    dir.allowExt("bmp");
+    dir.allowExt("tif");
+    dir.allowExt("tiff");
+    dir.listDir();
+    dir.sort();
+
+    files.clear();
+    for (int i = 0; i < dir.size(); i++) files.push_back(dir.getPath(i));
+
+    if (files.empty()) {
+        ofLogError("ImageSequenceSource") << "no images in " << path;
+        return false;
+    }
+    return true;
+}
+
+bool ImageSequenceSource::grab(cv::Mat& frame) {
+    if (finished) return false;
+
+    if (next >= files.size()) {
+        if (!loop) {
+            finished = true;
+            return false;
+        }
+        next = 0;
+    }
+
+    decoded = cv::imread(files[next++], color ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
+    if (decoded.empty()) {
+        ofLogWarning("ImageSequenceSource") << "can't read " << files[next - 1];
+        return false;
+    }
+
+    fit(decoded, frame);
+    advance();
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "FrameSource.h"
+
+// Replays the images in a directory (png, jpg, bmp, tif) in file name order.
+class ImageSequenceSource : public ReplaySource {
+
+    public:
+        ImageSequenceSource(const string& path, float framerate) : path(path), framerate(framerate) { }
+
+        bool setup(int width, int height, bool color) override;
+        bool grab(cv::Mat& frame) override;
+        string getName() const override { return "images " + path; }
+        float getFramerate() const override { return framerate; }
+
+    protected:
+        string path;
+        float framerate; // nominal, for timestamps
+        vector<string> files;
+        size_t next = 0;
+        cv::Mat decoded;
+
+};
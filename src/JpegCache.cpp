@@ -0,0 +1,177 @@
+#include "JpegCache.h"
+#include "Metrics.h"
+
+JpegCache::~JpegCache() {
+#ifdef PINOPTICAM_TURBOJPEG
+    for (auto& compressor : handles) {
+        tjDestroy(compressor.handle);
+        tjFree(compressor.data);
+    }
+#endif
+}
+
+void JpegCache::setup(int _capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = max(_capacity, 1);
+    entries.clear();
+    entries.reserve(capacity);
+    spares.clear();
+    spares.reserve(capacity);
+}
+
+int JpegCache::qualityFromLevel(int level) {
+    // the FreeImage levels behind OF_IMAGE_QUALITY_WORST ... OF_IMAGE_QUALITY_BEST
+    static const int qualities[] = { 10, 25, 50, 75, 100 };
+    return qualities[ofClamp(level, 1, 5) - 1];
+}
+
+JpegCache::Jpeg JpegCache::get(uint64_t seq, const ofPixels& pixels, int width, int height, int quality) {
+    if (width <= 0) width = pixels.getWidth();
+    if (height <= 0) height = pixels.getHeight();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto find = [&]() -> Entry* {
+            for (auto& entry : entries) {
+                if (entry.seq == seq && entry.width == width && entry.height == height && entry.quality == quality) return &entry;
+            }
+            return nullptr;
+        };
+
+        Entry* entry = find();
+        if (entry) {
+            // somebody else is on it
+            encoded.wait(lock, [&]() { entry = find(); return entry == nullptr || entry->jpeg != nullptr; });
+            if (entry) {
+                entry->lastUsed = ++useCounter;
+                numHits++;
+                Metrics::get().add(Metrics::JPEG_CACHE_HITS);
+                return entry->jpeg;
+            }
+        }
+
+        // claim the variant, evicting the least recently used finished one if full
+        if (entries.size() >= capacity) {
+            auto victim = entries.end();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->jpeg && (victim == entries.end() || it->lastUsed < victim->lastUsed)) victim = it;
+            }
+            if (victim != entries.end()) {
+                if (spares.size() < capacity) spares.push_back(const_pointer_cast<ofBuffer>(victim->jpeg));
+                entries.erase(victim);
+            }
+        }
+        entries.push_back({ seq, width, height, quality, nullptr, ++useCounter });
+    }
+
+    uint64_t start = ofGetElapsedTimeMicros();
+    Jpeg jpeg = encode(pixels, width, height, quality);
+    Metrics::get().record(Metrics::JPEG_ENCODE, ofGetElapsedTimeMicros() - start);
+    numEncodes++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : entries) {
+            if (entry.seq == seq && entry.width == width && entry.height == height && entry.quality == quality) {
+                entry.jpeg = jpeg;
+                break;
+            }
+        }
+    }
+    encoded.notify_all();
+    return jpeg;
+}
+
+JpegCache::Jpeg JpegCache::encodeUncached(const ofPixels& pixels, int quality) {
+    uint64_t start = ofGetElapsedTimeMicros();
+    Jpeg jpeg = encode(pixels, pixels.getWidth(), pixels.getHeight(), quality);
+    Metrics::get().record(Metrics::JPEG_ENCODE, ofGetElapsedTimeMicros() - start);
+    numEncodes++;
+    return jpeg;
+}
+
+shared_ptr<ofBuffer> JpegCache::acquireBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& spare : spares) {
+            if (spare.use_count() == 1) {
+                shared_ptr<ofBuffer> buffer = spare;
+                spare = spares.back();
+                spares.pop_back();
+                return buffer;
+            }
+        }
+    }
+    return make_shared<ofBuffer>();
+}
+
+JpegCache::Jpeg JpegCache::encode(const ofPixels& source, int width, int height, int quality) {
+    // one per encoding thread, kept for the next thumbnail of the same size
+    static thread_local AreaDownsampler downsampler;
+    static thread_local ofPixels resized;
+
+    const ofPixels* pixels = &source;
+    if (width != source.getWidth() || height != source.getHeight()) {
+        int channels = source.getNumChannels();
+        if (resized.getWidth() != width || resized.getHeight() != height || resized.getNumChannels() != channels) {
+            resized.allocate(width, height, channels);
+        }
+        downsampler.setup(source.getWidth(), source.getHeight(), width, height, channels);
+        downsampler.run(source.getData(), source.getWidth() * channels, resized.getData(), width * channels);
+        pixels = &resized;
+    }
+
+    shared_ptr<ofBuffer> buffer = acquireBuffer();
+
+#ifdef PINOPTICAM_TURBOJPEG
+    Compressor compressor;
+    {
+        std::lock_guard<std::mutex> lock(handleMutex);
+        if (!handles.empty()) {
+            compressor = handles.back();
+            handles.pop_back();
+        }
+    }
+    if (!compressor.handle) compressor.handle = tjInitCompress();
+
+    int channels = pixels->getNumChannels();
+    int subsampling = channels == 1 ? TJSAMP_GRAY : TJSAMP_420;
+    unsigned long needed = tjBufSize(width, height, subsampling);
+    if (compressor.capacity < needed) {
+        tjFree(compressor.data);
+        compressor.data = tjAlloc(needed);
+        compressor.capacity = needed;
+    }
+
+    // worst case sized, so turbojpeg never has to reallocate it
+    unsigned long size = compressor.capacity;
+    int result = tjCompress2(compressor.handle, pixels->getData(), width, 0, height,
+                             channels == 1 ? TJPF_GRAY : (channels == 4 ? TJPF_RGBA : TJPF_RGB),
+                             &compressor.data, &size, subsampling, quality, TJFLAG_FASTDCT | TJFLAG_NOREALLOC);
+    if (result == 0) {
+        buffer->set(reinterpret_cast<const char *>(compressor.data), size);
+    } else {
+        ofLogError("JpegCache") << tjGetErrorStr();
+        buffer->clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(handleMutex);
+        handles.push_back(compressor);
+    }
+#else
+    ofImageQualityType qualityType = OF_IMAGE_QUALITY_WORST;
+    if (quality >= 100) {
+        qualityType = OF_IMAGE_QUALITY_BEST;
+    } else if (quality >= 75) {
+        qualityType = OF_IMAGE_QUALITY_HIGH;
+    } else if (quality >= 50) {
+        qualityType = OF_IMAGE_QUALITY_MEDIUM;
+    } else if (quality >= 25) {
+        qualityType = OF_IMAGE_QUALITY_LOW;
+    }
+    ofSaveImage(*pixels, *buffer, OF_IMAGE_FORMAT_JPEG, qualityType);
+#endif
+
+    return buffer;
+}
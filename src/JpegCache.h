@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ofMain.h"
+#include "AreaDownsampler.h"
+
+#ifdef PINOPTICAM_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+// Encode-once JPEG cache. Every variant of a frame (sequence number, size, quality)
+// is encoded at most once and handed out as a shared immutable buffer, so MJPEG, sync
+// video and photos can all use the same encode. Concurrent requests for a variant that
+// is still being encoded wait for it rather than encoding it again. Thumbnails are
+// box-filtered straight into a per-thread buffer, and evicted JPEG buffers are reused
+// once nobody holds them, so steady state encoding doesn't allocate for either.
+// Build with -DPINOPTICAM_TURBOJPEG and -lturbojpeg (see config.make) to encode with
+// libjpeg-turbo and reused compressor handles instead of FreeImage.
+class JpegCache {
+
+    public:
+        typedef shared_ptr<const ofBuffer> Jpeg;
+
+        ~JpegCache();
+
+        void setup(int capacity = 8);
+
+        // any thread; pixels must be the frame with this seq. width / height of 0 mean the frame's own size.
+        // quality is 0 - 100.
+        Jpeg get(uint64_t seq, const ofPixels& pixels, int width, int height, int quality);
+
+        // any thread; a one-off encode that bypasses the cache, so it doesn't evict live frames
+        Jpeg encodeUncached(const ofPixels& pixels, int quality);
+
+        uint64_t getNumEncodes() const { return numEncodes.load(); }
+        uint64_t getNumHits() const { return numHits.load(); }
+
+        // 1 worst to 5 best, as used by sync_video_quality, to a 0 - 100 jpeg quality
+        static int qualityFromLevel(int level);
+
+    protected:
+        struct Entry {
+            uint64_t seq;
+            int width, height, quality;
+            Jpeg jpeg; // null while encoding
+            uint64_t lastUsed;
+        };
+
+        Jpeg encode(const ofPixels& pixels, int width, int height, int quality);
+        shared_ptr<ofBuffer> acquireBuffer();
+
+        std::mutex mutex;
+        std::condition_variable encoded;
+        vector<Entry> entries;
+        int capacity = 8;
+        uint64_t useCounter = 0;
+        vector<shared_ptr<ofBuffer>> spares; // evicted jpegs, reusable once the pool holds the only reference
+
+        std::atomic<uint64_t> numEncodes { 0 };
+        std::atomic<uint64_t> numHits { 0 };
+
+#ifdef PINOPTICAM_TURBOJPEG
+        struct Compressor {
+            tjhandle handle = nullptr;
+            unsigned char* data = nullptr; // output, grown to tjBufSize and kept
+            unsigned long capacity = 0;
+        };
+        std::mutex handleMutex;
+        vector<Compressor> handles; // idle compressors, one is created per concurrent encode
+#endif
+
+};
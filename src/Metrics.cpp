@@ -0,0 +1,168 @@
+#include "Metrics.h"
+
+const int Metrics::NUM_BUCKETS;
+const int Metrics::NUM_SHARDS;
+
+const uint64_t Metrics::BUCKET_BOUNDS[NUM_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000
+};
+
+Metrics& Metrics::get() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() {
+    for (auto& s : shards) {
+        for (int i = 0; i < NUM_STAGES; i++) {
+            for (auto& bucket : s.buckets[i]) bucket.store(0, std::memory_order_relaxed);
+            s.sumMicros[i].store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : s.counters) counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto& gauge : gauges) gauge.store(0, std::memory_order_relaxed);
+    startMicros = ofGetElapsedTimeMicros();
+}
+
+Metrics::Shard& Metrics::shard() {
+    thread_local int index = nextShard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+    return shards[index];
+}
+
+void Metrics::record(Stage stage, uint64_t micros) {
+    int bucket = 0;
+    while (bucket < NUM_BUCKETS && micros > BUCKET_BOUNDS[bucket]) bucket++;
+
+    Shard& s = shard();
+    s.buckets[stage][bucket].fetch_add(1, std::memory_order_relaxed);
+    s.sumMicros[stage].fetch_add(micros, std::memory_order_relaxed);
+}
+
+void Metrics::add(Counter counter, uint64_t value) {
+    shard().counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Metrics::set(Gauge gauge, int64_t value) {
+    gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+void Metrics::snapshot(Snapshot& snapshot) const {
+    memset(&snapshot, 0, sizeof(Snapshot));
+
+    for (auto& s : shards) {
+        for (int i = 0; i < NUM_STAGES; i++) {
+            for (int b = 0; b <= NUM_BUCKETS; b++) {
+                uint64_t n = s.buckets[i][b].load(std::memory_order_relaxed);
+                snapshot.buckets[i][b] += n;
+                snapshot.count[i] += n;
+            }
+            snapshot.sumMicros[i] += s.sumMicros[i].load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < NUM_COUNTERS; i++) snapshot.counters[i] += s.counters[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < NUM_GAUGES; i++) snapshot.gauges[i] = gauges[i].load(std::memory_order_relaxed);
+    snapshot.uptimeMicros = ofGetElapsedTimeMicros() - startMicros;
+}
+
+uint64_t Metrics::Snapshot::percentile(Stage stage, float quantile) const {
+    if (count[stage] == 0) return 0;
+    uint64_t target = max<uint64_t>(uint64_t(ceil(count[stage] * quantile)), 1);
+    uint64_t seen = 0;
+    for (int b = 0; b < NUM_BUCKETS; b++) {
+        seen += buckets[stage][b];
+        if (seen >= target) return BUCKET_BOUNDS[b];
+    }
+    return BUCKET_BOUNDS[NUM_BUCKETS - 1]; // overflow, at least this
+}
+
+float Metrics::Snapshot::meanMicros(Stage stage) const {
+    return count[stage] > 0 ? float(sumMicros[stage]) / count[stage] : 0;
+}
+
+// ~ ~ ~ NAMES ~ ~ ~
+const char* Metrics::getName(Stage stage) {
+    static const char* names[NUM_STAGES] = {
+        "capture", "convert", "change_detect", "pyramid", "blobs", "contours", "brightest_pixel", "analyze", "serialize",
+        "jpeg_encode", "send_osc", "send_ws", "send_mjpeg", "frame", "photo"
+    };
+    return names[stage];
+}
+
+const char* Metrics::getName(Counter counter) {
+    static const char* names[NUM_COUNTERS] = {
+        "frames_grabbed", "frames_processed", "dropped_grabber", "dropped_pipeline", "dropped_mjpeg", "dropped_ws",
+        "bytes_osc", "bytes_ws", "bytes_mjpeg", "messages_osc", "messages_ws", "jpeg_cache_hits", "photos",
+        "blob_full_scans", "blob_roi_scans", "frames_unchanged",
+        "arena_allocations", "arena_heap_allocations", "frames_shed"
+    };
+    return names[counter];
+}
+
+const char* Metrics::getName(Gauge gauge) {
+    static const char* names[NUM_GAUGES] = {
+        "queue_analyze", "queue_serialize", "queue_send", "queue_photo", "clients_mjpeg", "clients_ws",
+        "startup_ms", "first_frame_ms", "shed_level"
+    };
+    return names[gauge];
+}
+
+// ~ ~ ~ OUTPUT ~ ~ ~
+string Metrics::toJson(const Snapshot& snapshot, const string& hostName, const string& sessionId) {
+    ostringstream json;
+    json << "{\"unique_id\":\"" << sessionId << "\",\"hostname\":\"" << hostName << "\",\"uptime_ms\":" << snapshot.uptimeMicros / 1000;
+
+    json << ",\"stages\":{";
+    for (int i = 0; i < NUM_STAGES; i++) {
+        Stage stage = Stage(i);
+        if (i > 0) json << ",";
+        json << "\"" << getName(stage) << "\":{\"count\":" << snapshot.count[i] << ",\"mean_us\":" << snapshot.meanMicros(stage)
+             << ",\"p50_us\":" << snapshot.percentile(stage, 0.5) << ",\"p90_us\":" << snapshot.percentile(stage, 0.9)
+             << ",\"p99_us\":" << snapshot.percentile(stage, 0.99) << ",\"buckets\":[";
+        for (int b = 0; b <= NUM_BUCKETS; b++) json << (b > 0 ? "," : "") << snapshot.buckets[i][b];
+        json << "]}";
+    }
+    json << "},\"bucket_bounds_us\":[";
+    for (int b = 0; b < NUM_BUCKETS; b++) json << (b > 0 ? "," : "") << BUCKET_BOUNDS[b];
+
+    json << "],\"counters\":{";
+    for (int i = 0; i < NUM_COUNTERS; i++) json << (i > 0 ? "," : "") << "\"" << getName(Counter(i)) << "\":" << snapshot.counters[i];
+    json << "},\"gauges\":{";
+    for (int i = 0; i < NUM_GAUGES; i++) json << (i > 0 ? "," : "") << "\"" << getName(Gauge(i)) << "\":" << snapshot.gauges[i];
+    json << "}";
+
+    // share of frames change detection left alone
+    uint64_t unchanged = snapshot.counters[FRAMES_UNCHANGED];
+    uint64_t considered = unchanged + snapshot.counters[FRAMES_PROCESSED];
+    json << ",\"skip_ratio\":" << (considered > 0 ? float(unchanged) / considered : 0) << "}";
+    return json.str();
+}
+
+string Metrics::toPrometheus(const Snapshot& snapshot, const string& hostName) {
+    ostringstream text;
+    string labels = "host=\"" + hostName + "\"";
+
+    text << "# TYPE pinopticam_stage_seconds histogram\n";
+    for (int i = 0; i < NUM_STAGES; i++) {
+        string stageLabels = labels + ",stage=\"" + getName(Stage(i)) + "\"";
+        uint64_t cumulative = 0;
+        for (int b = 0; b < NUM_BUCKETS; b++) {
+            cumulative += snapshot.buckets[i][b];
+            text << "pinopticam_stage_seconds_bucket{" << stageLabels << ",le=\"" << BUCKET_BOUNDS[b] / 1e6 << "\"} " << cumulative << "\n";
+        }
+        text << "pinopticam_stage_seconds_bucket{" << stageLabels << ",le=\"+Inf\"} " << snapshot.count[i] << "\n";
+        text << "pinopticam_stage_seconds_sum{" << stageLabels << "} " << snapshot.sumMicros[i] / 1e6 << "\n";
+        text << "pinopticam_stage_seconds_count{" << stageLabels << "} " << snapshot.count[i] << "\n";
+    }
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        text << "# TYPE pinopticam_" << getName(Counter(i)) << "_total counter\n";
+        text << "pinopticam_" << getName(Counter(i)) << "_total{" << labels << "} " << snapshot.counters[i] << "\n";
+    }
+    for (int i = 0; i < NUM_GAUGES; i++) {
+        text << "# TYPE pinopticam_" << getName(Gauge(i)) << " gauge\n";
+        text << "pinopticam_" << getName(Gauge(i)) << "{" << labels << "} " << snapshot.gauges[i] << "\n";
+    }
+    text << "# TYPE pinopticam_uptime_seconds gauge\n";
+    text << "pinopticam_uptime_seconds{" << labels << "} " << snapshot.uptimeMicros / 1e6 << "\n";
+    return text.str();
+}
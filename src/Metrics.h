@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Process-wide hot-path instrumentation: fixed-bucket latency histograms per stage,
+// counters and gauges. Every thread writes to its own cache-line aligned shard with
+// relaxed atomic adds, so recording never takes a lock and threads don't contend;
+// reading sums the shards. Cheap enough to leave on in production.
+//
+// Served live on /metrics (Prometheus text) and /metrics.json of the post server and the
+// stream port; ofApp also sends the headline numbers as /stats over OSC.
+class Metrics {
+
+    public:
+        enum Stage {
+            CAPTURE, // source grab + copy into the slot
+            CONVERT, // share the grabbed buffer with a job
+            CHANGE_DETECT, // downsample + tile diff against the last analysed frame
+            PYRAMID, // roi, mask and box-filter levels for the analyses
+            BLOBS,
+            CONTOURS,
+            BRIGHTEST_PIXEL,
+            ANALYZE, // all analyses of a frame, in parallel
+            SERIALIZE,
+            JPEG_ENCODE, // every encode the JpegCache does
+            SEND_OSC,
+            SEND_WS,
+            SEND_MJPEG, // one frame to one client
+            FRAME, // grab to sent, end to end
+            PHOTO, // take_photo request to the file renamed into place
+            NUM_STAGES
+        };
+
+        enum Counter {
+            FRAMES_GRABBED,
+            FRAMES_PROCESSED,
+            DROPPED_GRABBER, // overwritten before the pipeline took them
+            DROPPED_PIPELINE, // no free job or analysis busy
+            DROPPED_MJPEG, // per client queues
+            DROPPED_WS,
+            BYTES_OSC,
+            BYTES_WS,
+            BYTES_MJPEG,
+            MESSAGES_OSC,
+            MESSAGES_WS,
+            JPEG_CACHE_HITS,
+            PHOTOS,
+            BLOB_FULL_SCANS, // blob tracking
+            BLOB_ROI_SCANS,
+            FRAMES_UNCHANGED, // change detection: not analysed or sent
+            ARENA_ALLOCATIONS, // contour scratch handed out by frame arenas
+            ARENA_HEAP_ALLOCATIONS, // arena overflow and growth, flat once warmed up
+            FRAMES_SHED, // analysed with some low priority work shed
+            NUM_COUNTERS
+        };
+
+        enum Gauge {
+            QUEUE_ANALYZE,
+            QUEUE_SERIALIZE,
+            QUEUE_SEND,
+            QUEUE_PHOTO,
+            CLIENTS_MJPEG,
+            CLIENTS_WS,
+            STARTUP_MS, // launch to the end of setup
+            FIRST_FRAME_MS, // launch to the first processed frame
+            SHED_LEVEL, // frame scheduler, 0 when nothing is shed
+            NUM_GAUGES
+        };
+
+        // bucket upper bounds in microseconds, plus one overflow bucket
+        static const int NUM_BUCKETS = 15;
+        static const uint64_t BUCKET_BOUNDS[NUM_BUCKETS];
+
+        struct Snapshot {
+            uint64_t buckets[NUM_STAGES][NUM_BUCKETS + 1];
+            uint64_t count[NUM_STAGES];
+            uint64_t sumMicros[NUM_STAGES];
+            uint64_t counters[NUM_COUNTERS];
+            int64_t gauges[NUM_GAUGES];
+            uint64_t uptimeMicros;
+
+            // upper bound of the bucket holding the given quantile, in microseconds
+            uint64_t percentile(Stage stage, float quantile) const;
+            float meanMicros(Stage stage) const;
+        };
+
+        static Metrics& get();
+
+        // any thread, lock-free
+        void record(Stage stage, uint64_t micros);
+        void add(Counter counter, uint64_t value = 1);
+        void set(Gauge gauge, int64_t value);
+
+        void snapshot(Snapshot& snapshot) const;
+
+        static const char* getName(Stage stage);
+        static const char* getName(Counter counter);
+        static const char* getName(Gauge gauge);
+
+        static string toJson(const Snapshot& snapshot, const string& hostName, const string& sessionId);
+        static string toPrometheus(const Snapshot& snapshot, const string& hostName);
+
+    protected:
+        Metrics();
+
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> buckets[NUM_STAGES][NUM_BUCKETS + 1];
+            std::atomic<uint64_t> sumMicros[NUM_STAGES];
+            std::atomic<uint64_t> counters[NUM_COUNTERS];
+        };
+
+        static const int NUM_SHARDS = 16; // threads beyond this share shards, still correctly
+        Shard& shard();
+
+        Shard shards[NUM_SHARDS];
+        std::atomic<int64_t> gauges[NUM_GAUGES];
+        std::atomic<int> nextShard { 0 };
+        uint64_t startMicros;
+
+};
+
+// Records the time from construction to destruction into a stage.
+class ScopedMetric {
+
+    public:
+        ScopedMetric(Metrics::Stage stage) : stage(stage), start(ofGetElapsedTimeMicros()) { }
+        ~ScopedMetric() { Metrics::get().record(stage, ofGetElapsedTimeMicros() - start); }
+
+    private:
+        Metrics::Stage stage;
+        uint64_t start;
+
+};
@@ -0,0 +1,19 @@
+#include "MetricsRoute.h"
+
+MetricsRoute::MetricsRoute(): ofxHTTP::BaseRoute(ofxHTTP::BaseRouteSettings("/metrics(\\.json)?")) {
+}
+
+void MetricsRoute::handleRequest(ofxHTTP::ServerEventArgs& evt) {
+    Poco::Net::HTTPServerResponse& response = evt.response();
+    string path = Poco::URI(evt.request().getURI()).getPath();
+
+    string body, contentType;
+    if (!onRoute || !onRoute(path, body, contentType)) {
+        response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+        response.send();
+        return;
+    }
+
+    response.setContentType(contentType);
+    response.sendBuffer(body.data(), body.size());
+}
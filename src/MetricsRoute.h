@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxHTTP.h"
+
+// /metrics (Prometheus text) and /metrics.json on the post server, so every node that
+// serves its web page also answers scrapes, whether or not it streams MJPEG. The body
+// comes from onRoute, the same callback MjpegServer answers its routes with.
+class MetricsRoute: public ofxHTTP::BaseRoute {
+
+    public:
+        MetricsRoute();
+
+        // any thread; true if path was answered
+        std::function<bool(const string& path, string& body, string& contentType)> onRoute;
+
+        void handleRequest(ofxHTTP::ServerEventArgs& evt) override;
+
+};
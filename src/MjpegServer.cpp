@@ -0,0 +1,255 @@
+#include "MjpegServer.h"
+#include "Metrics.h"
+
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/ServerSocket.h"
+
+#define MJPEG_BOUNDARY "pinopticam"
+
+class MjpegRequestHandler : public Poco::Net::HTTPRequestHandler {
+
+    public:
+        MjpegRequestHandler(MjpegServer& server) : server(server) { }
+
+        void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override {
+            server.handleRequest(request, response);
+        }
+
+    private:
+        MjpegServer& server;
+
+};
+
+class MjpegRequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+
+    public:
+        MjpegRequestHandlerFactory(MjpegServer& server) : server(server) { }
+
+        Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request) override {
+            return new MjpegRequestHandler(server);
+        }
+
+    private:
+        MjpegServer& server;
+
+};
+
+MjpegServer::~MjpegServer() {
+    stop();
+}
+
+void MjpegServer::setup(const Settings& _settings, JpegCache& _cache) {
+    settings = _settings;
+    cache = &_cache;
+    if (settings.qualities.empty()) settings.qualities.push_back(50);
+}
+
+void MjpegServer::start() {
+    stopping = false;
+
+    Poco::Net::HTTPServerParams::Ptr params = new Poco::Net::HTTPServerParams();
+    params->setMaxThreads(settings.maxConnections + 1); // + 1 so the page still loads when the streams are full
+    params->setMaxQueued(settings.maxConnections);
+    params->setKeepAlive(false);
+
+    server.reset(new Poco::Net::HTTPServer(new MjpegRequestHandlerFactory(*this), Poco::Net::ServerSocket(settings.port), params));
+    server->start();
+    encoder = std::thread(&MjpegServer::encodeLoop, this);
+    ofLogNotice("MjpegServer") << "MJPEG stream on port: " << settings.port;
+}
+
+void MjpegServer::stop() {
+    if (!server) return;
+    {
+        // notify under each client's lock: a streaming thread that tested the wait
+        // predicate before the flag was set is asleep by the time we get the lock
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        stopping = true;
+        for (auto& client : clients) {
+            std::lock_guard<std::mutex> clientLock(client->mutex);
+            client->wake.notify_all();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        posted.notify_all();
+    }
+    if (encoder.joinable()) encoder.join();
+    server->stopAll(true);
+    server.reset();
+}
+
+void MjpegServer::post(uint64_t seq, const shared_ptr<FrameBuffer>& buffer) {
+    if (numClients.load() == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        postedBuffer = buffer;
+        postedSeq = seq;
+    }
+    posted.notify_one();
+}
+
+void MjpegServer::encodeLoop() {
+    while (true) {
+        shared_ptr<FrameBuffer> buffer;
+        uint64_t seq;
+        {
+            std::unique_lock<std::mutex> lock(postMutex);
+            posted.wait(lock, [this]() { return stopping || postedBuffer; });
+            if (stopping) break;
+            buffer = std::move(postedBuffer);
+            postedBuffer.reset();
+            seq = postedSeq;
+        }
+
+        send(seq, [&](int quality) { return cache->get(seq, buffer->pixels, 0, 0, quality); });
+    }
+
+    std::lock_guard<std::mutex> lock(postMutex);
+    postedBuffer.reset(); // back to the grabber's pool
+}
+
+// encoder thread only
+void MjpegServer::send(uint64_t seq, std::function<JpegCache::Jpeg(int quality)> getVariant) {
+    uint64_t now = ofGetElapsedTimeMicros();
+
+    vector<shared_ptr<Client>> sendList;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        sendList = clients;
+    }
+
+    // decide who gets this frame, and at what quality, before encoding anything
+    for (auto& client : sendList) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->wantsFrame = client->pacer.shouldSend(now);
+        client->quality = client->pacer.getQuality();
+    }
+
+    for (auto& client : sendList) {
+        if (!client->wantsFrame) continue;
+
+        // the cache makes sure each quality is only encoded once
+        JpegCache::Jpeg jpeg = getVariant(client->quality);
+        if (!jpeg) continue;
+
+        {
+            std::lock_guard<std::mutex> lock(client->mutex);
+            if ((int) client->queue.size() >= settings.maxQueue) {
+                client->pacer.onDropped(client->queue.front()->size());
+                Metrics::get().add(Metrics::DROPPED_MJPEG);
+                client->queue.pop_front();
+            }
+            client->queue.push_back(jpeg);
+            client->pacer.onQueued(jpeg->size());
+        }
+        client->wake.notify_one();
+    }
+}
+
+void MjpegServer::getClientStats(vector<ClientStats>& stats) {
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (auto& client : clients) {
+        std::lock_guard<std::mutex> clientLock(client->mutex);
+        ClientStats s;
+        s.transport = "mjpeg";
+        s.address = client->address;
+        s.queuedFrames = client->queue.size();
+        client->pacer.fillStats(s);
+        stats.push_back(s);
+    }
+}
+
+void MjpegServer::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) {
+    string path = request.getURI();
+    string body, contentType;
+
+    if (path == "/ipvideo") {
+        stream(request, response);
+    } else if (path == "/clients") {
+        sendClientStats(response);
+    } else if (onRoute && onRoute(path, body, contentType)) {
+        response.setContentType(contentType);
+        response.sendBuffer(body.data(), body.size());
+    } else if (path == "/" || path == "/" + ofFilePath::getFileName(settings.indexFile)) {
+        response.sendFile(settings.indexFile, "text/html");
+    } else {
+        response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+        response.send();
+    }
+}
+
+void MjpegServer::sendClientStats(Poco::Net::HTTPServerResponse& response) {
+    vector<ClientStats> stats;
+    getClientStats(stats);
+    if (onClientStats) onClientStats(stats);
+
+    ostringstream json;
+    json << "[";
+    for (int i = 0; i < stats.size(); i++) {
+        const ClientStats& s = stats[i];
+        if (i > 0) json << ",";
+        json << "{\"transport\":\"" << s.transport << "\",\"address\":\"" << s.address << "\""
+             << ",\"queued_frames\":" << s.queuedFrames << ",\"queued_bytes\":" << s.queuedBytes
+             << ",\"sent_frames\":" << s.sentFrames << ",\"dropped_frames\":" << s.droppedFrames
+             << ",\"fps\":" << s.fps << ",\"latency_ms\":" << s.latencyMillis
+             << ",\"quality\":" << s.quality << ",\"framerate\":" << s.framerate << "}";
+    }
+    json << "]";
+
+    response.setContentType("application/json");
+    response.sendBuffer(json.str().data(), json.str().size());
+}
+
+void MjpegServer::stream(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) {
+    shared_ptr<Client> client = make_shared<Client>();
+    client->address = request.clientAddress().toString();
+    client->pacer.setup(settings.maxFramerate, settings.maxKbps, settings.qualities);
+
+    response.set("Cache-Control", "no-cache, no-store, must-revalidate");
+    response.set("Pragma", "no-cache");
+    response.setContentType("multipart/x-mixed-replace; boundary=" MJPEG_BOUNDARY);
+    std::ostream& out = response.send();
+
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        clients.push_back(client);
+    }
+    numClients++;
+    Metrics::get().set(Metrics::CLIENTS_MJPEG, numClients.load());
+
+    while (true) {
+        JpegCache::Jpeg jpeg;
+        {
+            std::unique_lock<std::mutex> lock(client->mutex);
+            client->wake.wait(lock, [&]() { return stopping || !client->queue.empty(); });
+            if (stopping) break;
+            jpeg = client->queue.front();
+            client->queue.pop_front();
+        }
+
+        // a slow link blocks here, which is what the pacer measures
+        uint64_t start = ofGetElapsedTimeMicros();
+        out << "--" MJPEG_BOUNDARY "\r\n";
+        out << "Content-Type: image/jpeg\r\n";
+        out << "Content-Length: " << jpeg->size() << "\r\n\r\n";
+        out.write(jpeg->getData(), jpeg->size());
+        out << "\r\n";
+        out.flush();
+        if (!out.good()) break; // client went away
+        uint64_t now = ofGetElapsedTimeMicros();
+        Metrics::get().record(Metrics::SEND_MJPEG, now - start);
+        Metrics::get().add(Metrics::BYTES_MJPEG, jpeg->size());
+
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->pacer.onSent(jpeg->size(), now - start);
+        client->pacer.update(now, client->queue.size());
+    }
+
+    numClients--;
+    Metrics::get().set(Metrics::CLIENTS_MJPEG, numClients.load());
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "JpegCache.h"
+#include "FrameBuffer.h"
+#include "ClientPacer.h"
+
+// MJPEG over HTTP, fed from the JpegCache on its own encoder thread: post() only hands
+// over the newest frame's buffer, so capture and analysis never wait for an encode, and
+// a frame that another consumer (sync video, photos) already encoded isn't encoded again. Serves the stream on /ipvideo, the viewer page on /, like
+// the ofxHTTP IPVideo server it replaces, per-client stats as JSON on /clients, and
+// whatever onRoute answers.
+// Every client has its own bounded queue (oldest frame dropped when full) and its own
+// ClientPacer, so one slow viewer gets a lower quality / frame rate instead of
+// slowing everyone down.
+class MjpegServer {
+
+    public:
+        struct Settings {
+            int port = 7111;
+            int maxConnections = 5;
+            int maxFramerate = 30; // per client
+            int maxKbps = 0; // per client, 0 for no limit
+            int maxQueue = 1; // frames waiting per client
+            vector<int> qualities { 50 }; // jpeg quality ladder, best first
+            string indexFile; // absolute path of the page served on /
+        };
+
+        ~MjpegServer();
+
+        void setup(const Settings& settings, JpegCache& cache);
+        void start();
+        void stop();
+
+        // any thread, never blocks: the frame waits for the encoder thread, replacing one it hasn't taken yet
+        void post(uint64_t seq, const shared_ptr<FrameBuffer>& buffer);
+
+        int getNumClients() const { return numClients.load(); }
+        void getClientStats(vector<ClientStats>& stats);
+
+        // extra stats for /clients, e.g. the WebSocket clients
+        std::function<void(vector<ClientStats>&)> onClientStats;
+        // extra routes: fill in body and contentType and return true to answer the request
+        std::function<bool(const string& path, string& body, string& contentType)> onRoute;
+
+        // called by the request handlers on Poco's threads
+        void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+    protected:
+        struct Client {
+            string address;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::deque<JpegCache::Jpeg> queue;
+            ClientPacer pacer;
+            bool wantsFrame = false; // passed the pacer for the frame being sent
+            int quality = 0;
+        };
+
+        void encodeLoop();
+        // getVariant is called once per quality that some client currently wants
+        void send(uint64_t seq, std::function<JpegCache::Jpeg(int quality)> getVariant);
+        void stream(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+        void sendClientStats(Poco::Net::HTTPServerResponse& response);
+
+        Settings settings;
+        JpegCache* cache = nullptr;
+        unique_ptr<Poco::Net::HTTPServer> server;
+
+        std::mutex clientsMutex;
+        vector<shared_ptr<Client>> clients;
+        std::atomic<bool> stopping { false };
+
+        // the newest posted frame, waiting for the encoder thread
+        std::thread encoder;
+        std::mutex postMutex;
+        std::condition_variable posted;
+        shared_ptr<FrameBuffer> postedBuffer;
+        uint64_t postedSeq = 0;
+
+        std::atomic<int> numClients { 0 };
+
+};
@@ -0,0 +1,239 @@
+#include "PeakFinder.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PEAKFINDER_NEON
+#elif defined(__AVX2__)
+    #include <immintrin.h>
+    #define PEAKFINDER_AVX2
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+    #define PEAKFINDER_SSE2
+#endif
+
+// only the color channels count towards brightness, never alpha
+static inline int brightnessAt(const uint8_t* p, int channels) {
+    if (channels < 3) return p[0];
+    return std::max(p[0], std::max(p[1], p[2]));
+}
+
+const char* PeakFinder::getKernelName() {
+#if defined(PEAKFINDER_NEON)
+    return "neon";
+#elif defined(PEAKFINDER_AVX2)
+    return "avx2";
+#elif defined(PEAKFINDER_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+uint8_t PeakFinder::rowMaxScalar(const uint8_t* p, int n) {
+    uint8_t best = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] > best) best = p[i];
+    }
+    return best;
+}
+
+uint8_t PeakFinder::rowMax(const uint8_t* p, int n) {
+    int i = 0;
+    uint8_t best = 0;
+
+#if defined(PEAKFINDER_NEON)
+    uint8x16_t m = vdupq_n_u8(0);
+    for (; i + 16 <= n; i += 16) m = vmaxq_u8(m, vld1q_u8(p + i));
+    uint8x8_t r = vmax_u8(vget_low_u8(m), vget_high_u8(m));
+    r = vpmax_u8(r, r);
+    r = vpmax_u8(r, r);
+    r = vpmax_u8(r, r);
+    best = vget_lane_u8(r, 0);
+#elif defined(PEAKFINDER_AVX2) || defined(PEAKFINDER_SSE2)
+    __m128i m = _mm_setzero_si128();
+    #if defined(PEAKFINDER_AVX2)
+    __m256i m256 = _mm256_setzero_si256();
+    for (; i + 32 <= n; i += 32) m256 = _mm256_max_epu8(m256, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+    m = _mm_max_epu8(_mm256_castsi256_si128(m256), _mm256_extracti128_si256(m256, 1));
+    #endif
+    for (; i + 16 <= n; i += 16) m = _mm_max_epu8(m, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+    best = _mm_cvtsi128_si32(m) & 0xff;
+#endif
+
+    for (; i < n; i++) {
+        if (p[i] > best) best = p[i];
+    }
+    return best;
+}
+
+// ~ ~ ~ BRIGHTEST PIXEL ~ ~ ~
+bool PeakFinder::findBrightestScalar(const uint8_t* data, int width, int height, int channels, int stride, int threshold, Peak& peak) {
+    int best = -1;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = data + y * stride;
+        for (int x = 0; x < width; x++) {
+            int b = brightnessAt(row + x * channels, channels);
+            if (b > best) {
+                best = b;
+                peak.x = x;
+                peak.y = y;
+            }
+        }
+    }
+
+    if (best <= threshold) return false;
+    peak.value = best;
+    peak.cx = peak.x;
+    peak.cy = peak.y;
+    return true;
+}
+
+bool PeakFinder::findBrightest(const uint8_t* data, int width, int height, int channels, int stride, int threshold, Peak& peak) {
+    // RGBA rows would let alpha win the row maximum
+    if (channels == 4) return findBrightestScalar(data, width, height, channels, stride, threshold, peak);
+
+    int best = -1;
+    int bestY = 0;
+
+    // for gray and RGB the row's largest byte is the row's largest brightness
+    for (int y = 0; y < height; y++) {
+        int m = rowMax(data + y * stride, width * channels);
+        if (m > best) {
+            best = m;
+            bestY = y;
+            if (best == 255) break; // nothing later can beat it
+        }
+    }
+
+    if (best <= threshold) return false;
+
+    const uint8_t* row = data + bestY * stride;
+    for (int x = 0; x < width; x++) {
+        if (brightnessAt(row + x * channels, channels) == best) {
+            peak.x = x;
+            break;
+        }
+    }
+    peak.y = bestY;
+    peak.value = best;
+    peak.cx = peak.x;
+    peak.cy = peak.y;
+    return true;
+}
+
+void PeakFinder::refineCentroid(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int radius, Peak& peak) {
+    float sum = 0;
+    float sumX = 0;
+    float sumY = 0;
+
+    int x0 = std::max(peak.x - radius, 0);
+    int x1 = std::min(peak.x + radius, width - 1);
+    int y0 = std::max(peak.y - radius, 0);
+    int y1 = std::min(peak.y + radius, height - 1);
+
+    for (int y = y0; y <= y1; y++) {
+        const uint8_t* row = data + y * stride;
+        for (int x = x0; x <= x1; x++) {
+            int w = brightnessAt(row + x * channels, channels) - threshold;
+            if (w <= 0) continue;
+            sum += w;
+            sumX += w * x;
+            sumY += w * y;
+        }
+    }
+
+    if (sum > 0) {
+        peak.cx = sumX / sum;
+        peak.cy = sumY / sum;
+    } else {
+        peak.cx = peak.x;
+        peak.cy = peak.y;
+    }
+}
+
+// ~ ~ ~ TOP-K PEAKS ~ ~ ~
+int PeakFinder::findPeaks(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int k, int minDistance, std::vector<Peak>& peaks) {
+    return findPeaks(data, width, height, channels, stride, threshold, k, minDistance, peaks, channels != 4);
+}
+
+int PeakFinder::findPeaksScalar(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int k, int minDistance, std::vector<Peak>& peaks) {
+    return findPeaks(data, width, height, channels, stride, threshold, k, minDistance, peaks, false);
+}
+
+int PeakFinder::findPeaks(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int k, int minDistance, std::vector<Peak>& peaks, bool simd) {
+    candidates.clear();
+    peaks.clear();
+
+    // a local maximum is >= all 8 neighbours, and strictly > the ones already scanned,
+    // so a plateau yields one candidate per pixel with no equal neighbour above or to its left:
+    // one for a rectangle, more for a U or a diagonal band, which minDistance then thins out
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = data + y * stride;
+
+        // dark rows can't hold a peak
+        int m = simd ? rowMax(row, width * channels) : rowMaxScalar(row, width * channels);
+        if (m <= threshold) continue;
+
+        for (int x = 0; x < width; x++) {
+            int b = brightnessAt(row + x * channels, channels);
+            if (b <= threshold) continue;
+
+            bool isPeak = true;
+            for (int dy = -1; dy <= 1 && isPeak; dy++) {
+                int ny = y + dy;
+                if (ny < 0 || ny >= height) continue;
+                const uint8_t* neighbourRow = data + ny * stride;
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = x + dx;
+                    if ((dx == 0 && dy == 0) || nx < 0 || nx >= width) continue;
+                    int n = brightnessAt(neighbourRow + nx * channels, channels);
+                    bool before = dy < 0 || (dy == 0 && dx < 0);
+                    if (n > b || (before && n == b)) {
+                        isPeak = false;
+                        break;
+                    }
+                }
+            }
+
+            if (isPeak) {
+                Peak peak;
+                peak.x = x;
+                peak.y = y;
+                peak.value = b;
+                candidates.push_back(peak);
+            }
+        }
+    }
+
+    // brightest first, scan order breaks ties
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Peak& a, const Peak& b) { return a.value > b.value; });
+
+    int minDistanceSq = minDistance * minDistance;
+    for (auto& candidate : candidates) {
+        if ((int) peaks.size() >= k) break;
+
+        bool separated = true;
+        for (auto& peak : peaks) {
+            int dx = peak.x - candidate.x;
+            int dy = peak.y - candidate.y;
+            if (dx * dx + dy * dy < minDistanceSq) {
+                separated = false;
+                break;
+            }
+        }
+
+        if (separated) {
+            refineCentroid(data, width, height, channels, stride, threshold, 2, candidate);
+            peaks.push_back(candidate);
+        }
+    }
+
+    return peaks.size();
+}
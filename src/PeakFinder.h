@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Brightest pixel / top-K peak search over 8-bit gray or RGB frames.
+// Brightness is max(r, g, b), the same as ofColor::getBrightness(), and the search
+// covers every pixel. The heavy lifting is a SIMD row maximum (NEON on the Pi,
+// AVX2 / SSE2 on x86): rows that can't beat the current best are skipped without
+// looking at individual pixels. The *Scalar versions are straightforward per-pixel
+// reference implementations that the SIMD paths must agree with exactly.
+class PeakFinder {
+
+    public:
+        struct Peak {
+            int x = 0;
+            int y = 0;
+            int value = 0; // brightness, 0-255
+            float cx = 0; // intensity-weighted centroid around (x, y)
+            float cy = 0;
+        };
+
+        // first pixel in scan order with the highest brightness, if that brightness is > threshold;
+        // cx / cy are just x / y, only findPeaks refines centroids
+        static bool findBrightest(const uint8_t* data, int width, int height, int channels, int stride, int threshold, Peak& peak);
+        static bool findBrightestScalar(const uint8_t* data, int width, int height, int channels, int stride, int threshold, Peak& peak);
+
+        // up to k local maxima above threshold, brightest first, at least minDistance pixels apart
+        int findPeaks(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int k, int minDistance, std::vector<Peak>& peaks);
+        int findPeaksScalar(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int k, int minDistance, std::vector<Peak>& peaks);
+
+        // fills peak.cx / peak.cy from a (2 * radius + 1)^2 window, weighted by brightness above threshold
+        static void refineCentroid(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int radius, Peak& peak);
+
+        // the largest byte in p[0..n), vectorized where available
+        static uint8_t rowMax(const uint8_t* p, int n);
+        static uint8_t rowMaxScalar(const uint8_t* p, int n);
+
+        static const char* getKernelName();
+
+    protected:
+        int findPeaks(const uint8_t* data, int width, int height, int channels, int stride, int threshold, int k, int minDistance, std::vector<Peak>& peaks, bool simd);
+
+        std::vector<Peak> candidates; // reused between frames
+
+};
@@ -0,0 +1,143 @@
+#include "PhotoQueue.h"
+#include "Metrics.h"
+
+#include <cstdio>
+
+PhotoQueue::~PhotoQueue() {
+    stop();
+}
+
+void PhotoQueue::setup(string _photoDirectory, string _prefix, int _maxDepth, JpegCache& _cache, int _quality) {
+    photoDirectory = _photoDirectory;
+    prefix = _prefix;
+    maxDepth = max(_maxDepth, 1);
+    cache = &_cache;
+    quality = _quality;
+
+    ofDirectory::createDirectory(photoDirectory, false, true);
+
+    pool.clear();
+    freeSlots.clear();
+    for (int i = 0; i < maxDepth; i++) {
+        pool.emplace_back(new Photo());
+        freeSlots.push_back(pool.back().get());
+    }
+}
+
+void PhotoQueue::start() {
+    stopping = false;
+    worker = std::thread(&PhotoQueue::workerLoop, this);
+}
+
+void PhotoQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+PhotoQueue::Result PhotoQueue::request(Type type, const ofPixels& pixels, int timestamp, uint64_t seq) {
+    uint64_t requestMicros = ofGetElapsedTimeMicros();
+    Photo* photo;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (waiting[type]) {
+            numCoalesced++;
+            return COALESCED;
+        }
+        if (freeSlots.empty()) {
+            numRejected++;
+            return REJECTED;
+        }
+        photo = freeSlots.back();
+        freeSlots.pop_back();
+        waiting[type] = true;
+    }
+
+    // the slot is ours until it's queued, so copy outside the lock
+    photo->type = type;
+    photo->pixels = pixels; // reuses the slot's allocation when the size matches
+    photo->timestamp = timestamp;
+    photo->seq = seq;
+    photo->requestMicros = requestMicros;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(photo);
+        Metrics::get().set(Metrics::QUEUE_PHOTO, pending.size());
+    }
+    wake.notify_one();
+    return QUEUED;
+}
+
+void PhotoQueue::workerLoop() {
+    while (true) {
+        Photo* photo;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            photo = pending.front();
+            pending.pop_front();
+            Metrics::get().set(Metrics::QUEUE_PHOTO, pending.size());
+            waiting[photo->type] = false; // from here on a new request gets a fresh frame
+        }
+
+        process(*photo);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(photo);
+    }
+}
+
+void PhotoQueue::process(Photo& photo) {
+    Metrics::get().add(Metrics::PHOTOS);
+    photo.jpeg = cache->get(photo.seq, photo.pixels, 0, 0, quality);
+
+    if (photo.type == STREAM) {
+        if (onEncoded) onEncoded(photo);
+        photo.jpeg.reset();
+        return;
+    }
+
+    photo.fileName = prefix + "_photo_" + ofToString(photo.timestamp) + ".jpg";
+    string finalPath = ofFilePath::join(photoDirectory, photo.fileName);
+    string tempPath = finalPath + ".tmp";
+
+    // write under a temporary name so the web server never serves a half-written file
+    if (!ofBufferToFile(tempPath, *photo.jpeg, true) || std::rename(tempPath.c_str(), finalPath.c_str()) != 0) {
+        ofLogError("PhotoQueue") << "could not write " << finalPath;
+        return;
+    }
+
+    uint64_t micros = ofGetElapsedTimeMicros() - photo.requestMicros;
+    Metrics::get().record(Metrics::PHOTO, micros);
+    float latency = micros / 1000.0;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastLatency = latency;
+        averageLatency = averageLatency == 0 ? latency : ofLerp(averageLatency, latency, 0.1);
+        maxLatency = max(maxLatency, latency);
+    }
+
+    if (onSaved) onSaved(photo);
+    photo.jpeg.reset();
+}
+
+float PhotoQueue::getLastLatencyMillis() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return lastLatency;
+}
+
+float PhotoQueue::getAverageLatencyMillis() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return averageLatency;
+}
+
+float PhotoQueue::getMaxLatencyMillis() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return maxLatency;
+}
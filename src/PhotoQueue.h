@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ofMain.h"
+#include "JpegCache.h"
+
+// Takes photos off the HTTP / WebSocket event threads. A request copies the frame into
+// a pooled slot and returns; a worker thread gets the JPEG from the JpegCache (so a frame
+// that was already encoded at photo quality isn't encoded again), writes the file under
+// a temporary name and renames it into place, then reports back through onSaved.
+// A request that arrives while one of the same kind is still waiting to start is
+// coalesced into it, and at most maxDepth photos are in flight at once.
+class PhotoQueue {
+
+    public:
+        enum Type {
+            SAVE, // write to DocumentRoot/photos
+            STREAM // encode only, for sending to clients
+        };
+
+        enum Result {
+            QUEUED,
+            COALESCED,
+            REJECTED // queue full
+        };
+
+        struct Photo {
+            Type type;
+            ofPixels pixels;
+            int timestamp = 0;
+            uint64_t seq = 0;
+            uint64_t requestMicros = 0;
+            JpegCache::Jpeg jpeg;
+            string fileName; // SAVE only, relative to the photo directory
+        };
+
+        ~PhotoQueue();
+
+        void setup(string photoDirectory, string prefix, int maxDepth, JpegCache& cache, int quality);
+        void start();
+        void stop();
+
+        // any thread; copies the pixels before returning
+        Result request(Type type, const ofPixels& pixels, int timestamp, uint64_t seq);
+
+        // called on the worker thread
+        std::function<void(Photo&)> onSaved; // the file is on disk under its final name
+        std::function<void(Photo&)> onEncoded; // STREAM photos
+
+        // time from request() to the file being on disk, in milliseconds; also the PHOTO metrics stage
+        float getLastLatencyMillis();
+        float getAverageLatencyMillis();
+        float getMaxLatencyMillis();
+        uint64_t getNumCoalesced() const { return numCoalesced.load(); }
+        uint64_t getNumRejected() const { return numRejected.load(); }
+
+    protected:
+        void workerLoop();
+        void process(Photo& photo);
+
+        string photoDirectory, prefix;
+        int maxDepth = 4;
+        JpegCache* cache = nullptr;
+        int quality = 100;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<Photo*> pending;
+        vector<unique_ptr<Photo>> pool;
+        vector<Photo*> freeSlots;
+        bool waiting[2] = { false, false }; // a request of this type is queued but not started
+        bool stopping = false;
+        std::thread worker;
+
+        std::mutex statsMutex;
+        float lastLatency = 0;
+        float averageLatency = 0;
+        float maxLatency = 0;
+        std::atomic<uint64_t> numCoalesced { 0 };
+        std::atomic<uint64_t> numRejected { 0 };
+
+};
@@ -0,0 +1,38 @@
+#include "PiCamSource.h"
+
+#ifdef TARGET_RASPBERRY_PI
+
+bool PiCamSource::setup(int width, int height, bool color) {
+    cam.setup(width, height, settings.framerate, color); // color/gray;
+
+    cam.setRotation(settings.rotation);
+    cam.setSharpness(settings.sharpness);
+    cam.setContrast(settings.contrast);
+    cam.setBrightness(settings.brightness);
+    cam.setISO(settings.iso);
+    cam.setExposureMode((MMAL_PARAM_EXPOSUREMODE_T) settings.exposureMode);
+    cam.setExposureCompensation(settings.exposureCompensation);
+    cam.setShutterSpeed(settings.shutterSpeed);
+    //cam.setFrameRate // not implemented in ofxCvPiCam 
+    return true;
+}
+
+bool PiCamSource::grab(cv::Mat& frame) {
+    cv::Mat grabbed = cam.grab();
+    if (grabbed.empty()) return false;
+    grabbed.copyTo(frame);
+    return true;
+}
+
+#else
+
+bool PiCamSource::setup(int width, int height, bool color) {
+    ofLogError("PiCamSource") << "built without TARGET_RASPBERRY_PI, no camera available";
+    return false;
+}
+
+bool PiCamSource::grab(cv::Mat& frame) {
+    return false;
+}
+
+#endif
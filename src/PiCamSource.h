@@ -0,0 +1,43 @@
+#pragma once
+
+#include "FrameSource.h"
+
+#ifdef TARGET_RASPBERRY_PI
+#include "ofxCvPiCam.h"
+#endif
+
+// The Raspberry Pi camera through ofxCvPiCam (MMAL). Only built on the Pi; everywhere
+// else setup() fails and one of the replay sources has to be used instead.
+class PiCamSource : public FrameSource {
+
+    public:
+        // for more camera settings, see:
+        // https://github.com/orgicus/ofxCvPiCam/blob/master/example-ofxCvPiCam-allSettings/src/testApp.cpp
+        struct Settings {
+            int framerate = 30;
+            int rotation = 0;
+            int shutterSpeed = 0; // 0 to 330000 in microseconds, default 0
+            int sharpness = 0; // -100 to 100, default 0
+            int contrast = 0; // -100 to 100, default 0
+            int brightness = 50; // 0 to 100, default 50
+            int iso = 300; // 100 to 800, default 300
+            int exposureCompensation = 0; // -10 to 10, default 0
+            // 0 off, 1 auto, 2 night, 3 night preview, 4 backlight, 5 spotlight, 6 sports, 7, snow, 8 beach, 9 very long, 10 fixed fps, 11 antishake, 12 fireworks, 13 max
+            int exposureMode = 0; // 0 to 13, default 0
+        };
+
+        PiCamSource(const Settings& settings) : settings(settings) { }
+
+        bool setup(int width, int height, bool color) override;
+        bool grab(cv::Mat& frame) override;
+        string getName() const override { return "picam"; }
+        float getFramerate() const override { return settings.framerate; }
+
+    protected:
+        Settings settings;
+
+#ifdef TARGET_RASPBERRY_PI
+        ofxCvPiCam cam;
+#endif
+
+};
@@ -0,0 +1,253 @@
+#include "PreRollBuffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+
+#define PREROLL_QUEUE_SIZE 4 // frames waiting for the writer before new ones are dropped
+
+PreRollBuffer::~PreRollBuffer() {
+    stop();
+    close();
+}
+
+bool PreRollBuffer::setup(int width, int height, int channels, const Settings& _settings, JpegCache& _cache) {
+    close();
+    settings = _settings;
+    cache = &_cache;
+
+    int framerate = max(settings.framerate, 1);
+    preFrames = max(int(ceil(settings.preSeconds * framerate)), 1);
+    postFrames = max(int(ceil(settings.postSeconds * framerate)), 0);
+
+    // a second to spare, so the post-roll can be written without touching the pre-roll;
+    // after that the writer waits for the dump, see write()
+    FrameDumpHeader init;
+    init.init(width, height, channels, preFrames + postFrames + framerate);
+
+    string fullPath = ofToDataPath(settings.path, true);
+    fd = open(fullPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    size = init.fileSize();
+    // reserve the blocks up front, so a full disk shows up now and not mid-recording
+    if (fd < 0 || posix_fallocate(fd, 0, size) != 0) {
+        ofLogError("PreRollBuffer") << "can't create " << fullPath << " (" << size / (1024 * 1024) << " MB)";
+        close();
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ofLogError("PreRollBuffer") << "can't map " << fullPath;
+        close();
+        return false;
+    }
+    data = static_cast<uint8_t*>(mapped);
+    header = reinterpret_cast<FrameDumpHeader*>(data);
+    *header = init;
+
+    queue.setCapacity(PREROLL_QUEUE_SIZE);
+    dumpRecords.reserve(header->capacity);
+    ofDirectory::createDirectory(settings.outputDirectory, false, true);
+
+    ofLogNotice("PreRollBuffer") << header->capacity << " frames, " << size / (1024 * 1024) << " MB in " << fullPath;
+    return true;
+}
+
+void PreRollBuffer::close() {
+    if (data) munmap(data, size);
+    if (fd >= 0) ::close(fd);
+    data = nullptr;
+    header = nullptr;
+    fd = -1;
+}
+
+void PreRollBuffer::start() {
+    if (!header || writer.joinable()) return;
+    queue.reopen();
+    stopping = false;
+    writer = std::thread(&PreRollBuffer::writerLoop, this);
+    dumper = std::thread(&PreRollBuffer::dumpLoop, this);
+}
+
+void PreRollBuffer::stop() {
+    queue.close();
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        stopping = true;
+    }
+    dumpWake.notify_all();
+    if (writer.joinable()) writer.join();
+    if (dumper.joinable()) dumper.join();
+}
+
+PreRollBuffer::Format PreRollBuffer::formatFromString(const string& format) {
+    return format == "mjpeg" ? MJPEG : IMAGES;
+}
+
+// ~ ~ ~ RECORDING ~ ~ ~
+void PreRollBuffer::add(const shared_ptr<FrameBuffer>& buffer, uint64_t seq, int timestamp, uint64_t grabMicros) {
+    Pending frame;
+    frame.buffer = buffer;
+    frame.seq = seq;
+    frame.timestamp = timestamp;
+    frame.grabMicros = grabMicros;
+    if (!queue.tryPush(std::move(frame))) framesDropped++;
+}
+
+void PreRollBuffer::writerLoop() {
+    Pending frame;
+    while (queue.pop(frame)) {
+        write(frame);
+        frame.buffer.reset(); // back to the grabber's pool
+    }
+}
+
+void PreRollBuffer::write(const Pending& frame) {
+    const cv::Mat& mat = frame.buffer->mat;
+    if (uint32_t(mat.cols) != header->width || uint32_t(mat.rows) != header->height || uint32_t(mat.channels()) != header->channels) {
+        framesDropped++;
+        return;
+    }
+
+    // fill the next record, overwriting the oldest once the ring is full
+    uint32_t index = header->numFrames < header->capacity ? header->numFrames : header->first;
+    FrameDumpRecord* r = record(index);
+
+    // a dump still needs this record
+    uint64_t oldSeq = __atomic_load_n(&r->seq, __ATOMIC_RELAXED);
+    if (oldSeq >= holdFrom.load() && oldSeq <= holdTo.load()) {
+        framesDropped++;
+        return;
+    }
+
+    // seq 0 marks the record as being written, readers check it before and after copying
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_release);
+    r->timestamp = frame.timestamp;
+    r->grabMicros = frame.grabMicros;
+    memcpy(reinterpret_cast<uint8_t*>(r) + sizeof(FrameDumpRecord), mat.data, header->frameBytes());
+    __atomic_store_n(&r->seq, frame.seq, __ATOMIC_RELEASE);
+
+    if (header->numFrames < header->capacity) {
+        header->numFrames++;
+    } else {
+        header->first = (header->first + 1) % header->capacity;
+    }
+    newestSeq = frame.seq;
+    framesWritten++;
+}
+
+// ~ ~ ~ DUMPING ~ ~ ~
+bool PreRollBuffer::trigger(Format format) {
+    if (!header) return false;
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        if (dumping) return false;
+        dumping = true;
+        triggered = true;
+        triggerFormat = format;
+    }
+    dumpWake.notify_all();
+    return true;
+}
+
+void PreRollBuffer::dumpLoop() {
+    while (true) {
+        Format format;
+        {
+            std::unique_lock<std::mutex> lock(dumpMutex);
+            dumpWake.wait(lock, [this]() { return stopping || triggered; });
+            if (stopping) return;
+            triggered = false;
+            format = triggerFormat;
+        }
+
+        dump(newestSeq.load(), format);
+        dumping = false;
+    }
+}
+
+void PreRollBuffer::dump(uint64_t triggerSeq, Format format) {
+    uint64_t firstSeq = triggerSeq > uint64_t(preFrames) ? triggerSeq - preFrames + 1 : 1;
+    uint64_t lastSeq = triggerSeq + postFrames;
+    holdTo = lastSeq; // before holdFrom, so there's never a hold reaching back to seq 0
+    holdFrom = firstSeq;
+    auto release = [this]() {
+        holdFrom = UINT64_MAX;
+        holdTo = 0;
+    };
+
+    // wait for the post-roll, giving up a second after it should have arrived
+    uint64_t deadline = ofGetElapsedTimeMicros() + uint64_t((settings.postSeconds + 1) * 1000000);
+    while (newestSeq.load() < lastSeq && ofGetElapsedTimeMicros() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(dumpMutex);
+            if (stopping) {
+                release();
+                return;
+            }
+        }
+        ofSleepMillis(10);
+    }
+
+    // the ring isn't in seq order once it has wrapped, so find and sort the records we want
+    dumpRecords.clear();
+    for (uint32_t i = 0; i < header->capacity; i++) {
+        uint64_t seq = __atomic_load_n(&record(i)->seq, __ATOMIC_ACQUIRE);
+        if (seq >= firstSeq && seq <= lastSeq) dumpRecords.emplace_back(seq, i);
+    }
+    std::sort(dumpRecords.begin(), dumpRecords.end());
+
+    // seq starts over with every run, so the wall clock keeps names from earlier runs apart
+    string name = settings.prefix + "_burst_" + ofGetTimestampString("%Y%m%d-%H%M%S-%i") + "_" + ofToString(triggerSeq);
+    string finalPath = ofFilePath::join(settings.outputDirectory, format == MJPEG ? name + ".mjpeg" : name);
+    string tempPath = finalPath + ".tmp";
+    std::ofstream stream;
+    if (format == MJPEG) {
+        stream.open(tempPath, std::ios::binary | std::ios::trunc);
+    } else {
+        ofDirectory::createDirectory(tempPath, false, true);
+    }
+
+    dumpPixels.allocate(header->width, header->height, header->channels);
+    int numFrames = 0;
+    int numSkipped = 0;
+    for (auto& entry : dumpRecords) {
+        FrameDumpRecord* r = record(entry.second);
+        memcpy(dumpPixels.getData(), reinterpret_cast<uint8_t*>(r) + sizeof(FrameDumpRecord), header->frameBytes());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool overwritten = __atomic_load_n(&r->seq, __ATOMIC_RELAXED) != entry.first;
+        holdFrom = entry.first + 1; // copied, the writer may have the record back
+        if (overwritten) { // only a frame the writer was already writing when the hold began
+            numSkipped++;
+            continue;
+        }
+
+        JpegCache::Jpeg jpeg = cache->encodeUncached(dumpPixels, settings.quality);
+        if (format == MJPEG) {
+            stream.write(jpeg->getData(), jpeg->size());
+        } else {
+            char fileName[32];
+            snprintf(fileName, sizeof fileName, "frame_%05d.jpg", numFrames);
+            ofBufferToFile(ofFilePath::join(tempPath, fileName), *jpeg, true);
+        }
+        numFrames++;
+    }
+    if (format == MJPEG) stream.close();
+    release();
+    int expected = int(lastSeq - firstSeq + 1);
+    if (numFrames < expected) {
+        ofLogWarning("PreRollBuffer") << expected - numFrames << " of " << expected << " frames around " << triggerSeq
+                                      << " missing (" << numSkipped << " overwritten, the rest never reached the ring)";
+    }
+
+    // rename into place so the web server never serves half a burst
+    if (std::rename(tempPath.c_str(), finalPath.c_str()) != 0) {
+        ofLogError("PreRollBuffer") << "could not write " << finalPath;
+        return;
+    }
+    ofLogNotice("PreRollBuffer") << numFrames << " frames around " << triggerSeq << " to " << finalPath;
+    if (onDumped) onDumped(ofFilePath::getFileName(finalPath), numFrames);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FrameBuffer.h"
+#include "FrameDump.h"
+#include "BoundedQueue.h"
+#include "JpegCache.h"
+
+// Keeps the last few seconds of full resolution frames so a trigger can save what
+// happened before it as well as after. Frames are stored raw in a ring of records in a
+// preallocated, memory-mapped frame dump file (see FrameDump.h), so the history lives in
+// the page cache rather than the heap and the kernel can write it back under memory
+// pressure. The file can be replayed later with the raw frame source.
+//
+// add() never blocks: it hands a shared FrameBuffer to a writer thread, and drops the
+// frame if the writer is behind. trigger() starts a dump on its own thread that waits for
+// the post-roll, then copies the frames around the trigger out of the ring and writes
+// them as a directory of JPEGs or a single MJPEG file under outputDirectory. While a dump
+// runs, the writer drops new frames rather than overwrite a record the dump still has to
+// encode, so a slow encode costs frames after the burst, not frames in it. Records are
+// also sequence-locked, so a frame overwritten mid-copy anyway is skipped (and logged), never torn.
+class PreRollBuffer {
+
+    public:
+        enum Format {
+            IMAGES, // one jpeg per frame in a directory
+            MJPEG // concatenated jpegs in one .mjpeg file
+        };
+
+        struct Settings {
+            string path = "preroll.pfd"; // the ring file, relative to bin/data
+            float preSeconds = 5;
+            float postSeconds = 2;
+            int framerate = 30;
+            int quality = 90;
+            string outputDirectory; // absolute
+            string prefix; // file name prefix, e.g. the host name
+        };
+
+        ~PreRollBuffer();
+
+        bool setup(int width, int height, int channels, const Settings& settings, JpegCache& cache);
+        void start();
+        void stop();
+
+        // any thread; the buffer must not be written to afterwards
+        void add(const shared_ptr<FrameBuffer>& buffer, uint64_t seq, int timestamp, uint64_t grabMicros);
+
+        // any thread; false if a dump is already under way
+        bool trigger(Format format);
+
+        // called on the dump thread, path is relative to outputDirectory
+        std::function<void(const string& path, int numFrames)> onDumped;
+
+        uint64_t getFramesWritten() const { return framesWritten.load(); }
+        uint64_t getFramesDropped() const { return framesDropped.load(); }
+        bool isDumping() const { return dumping.load(); }
+
+        static Format formatFromString(const string& format); // "images" or "mjpeg"
+
+    protected:
+        struct Pending {
+            shared_ptr<FrameBuffer> buffer;
+            uint64_t seq = 0;
+            int timestamp = 0;
+            uint64_t grabMicros = 0;
+        };
+
+        void writerLoop();
+        void write(const Pending& frame);
+        void dumpLoop();
+        void dump(uint64_t triggerSeq, Format format);
+        void close();
+
+        FrameDumpRecord* record(uint32_t index) { return reinterpret_cast<FrameDumpRecord*>(data + header->recordOffset(index)); }
+
+        Settings settings;
+        JpegCache* cache = nullptr;
+        int preFrames = 0, postFrames = 0;
+
+        int fd = -1;
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        FrameDumpHeader* header = nullptr; // in the mapping, written by the writer thread only
+
+        BoundedQueue<Pending> queue;
+        std::thread writer;
+        std::atomic<uint64_t> newestSeq { 0 };
+        // seqs the dump still needs, which the writer won't overwrite; holdFrom only grows during a dump
+        std::atomic<uint64_t> holdFrom { UINT64_MAX };
+        std::atomic<uint64_t> holdTo { 0 };
+        std::atomic<uint64_t> framesWritten { 0 };
+        std::atomic<uint64_t> framesDropped { 0 };
+
+        std::thread dumper;
+        std::mutex dumpMutex;
+        std::condition_variable dumpWake;
+        bool stopping = false;
+        bool triggered = false;
+        Format triggerFormat = IMAGES;
+        std::atomic<bool> dumping { false };
+
+        // dump thread only
+        vector<pair<uint64_t, uint32_t>> dumpRecords; // seq, record index
+        ofPixels dumpPixels;
+
+};
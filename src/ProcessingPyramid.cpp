@@ -0,0 +1,38 @@
+#include "ProcessingPyramid.h"
+
+void ProcessingPyramid::build(const cv::Mat& frame, const Settings& settings) {
+    cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    roi = settings.roi.area() > 0 ? settings.roi & bounds : bounds;
+    if (roi.area() == 0) roi = bounds;
+
+    if (levels.size() < settings.levels + 1) {
+        levels.resize(settings.levels + 1);
+        downsamplers.resize(settings.levels + 1);
+    }
+
+    // level 0 is free unless it's masked. copyTo() with a mask zero-fills the destination
+    // whenever it has to allocate it, and never writes outside the mask afterwards, so the
+    // masked-out pixels stay 0. create() doesn't zero anything: don't swap this for
+    // create() + a masked copy without clearing the buffer first
+    if (!settings.mask.empty() && settings.mask.size() == frame.size()) {
+        frame(roi).copyTo(masked, settings.mask(roi));
+        levels[0] = masked;
+    } else {
+        levels[0] = frame(roi);
+    }
+
+    // each level from the one above, dropping an odd last row or column
+    numLevels = 1;
+    for (int i = 1; i <= settings.levels; i++) {
+        const cv::Mat& above = levels[i - 1];
+        int width = above.cols / 2;
+        int height = above.rows / 2;
+        if (width == 0 || height == 0) break;
+
+        cv::Mat& level = levels[i];
+        level.create(height, width, above.type());
+        downsamplers[i].setup(width * 2, height * 2, width, height, above.channels());
+        downsamplers[i].run(above.ptr<uint8_t>(), above.step, level.ptr<uint8_t>(), level.step);
+        numLevels++;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "AreaDownsampler.h"
+
+// The image the analyses work on: the frame, cut down to a region of interest and
+// masked if configured, then halved level by level with a 2x2 box filter. Built once
+// per frame by the analyze stage, only as deep as the deepest level an analysis asked
+// for, and then read by the analyses concurrently. A pixel at level n covers 2^n x 2^n
+// frame pixels, and toFrame() maps coordinates found at a level back onto the full
+// frame, so results look the same to receivers whatever level they came from.
+class ProcessingPyramid {
+
+    public:
+        struct Settings {
+            cv::Rect roi; // full-frame pixels, empty for the whole frame
+            cv::Mat mask; // full-frame sized, 8-bit, 0 where nothing should be found; empty for none
+            int levels = 0; // halvings to build, 0 for full resolution only
+        };
+
+        void build(const cv::Mat& frame, const Settings& settings);
+
+        // the level an analysis asking for this one gets, if the frame is too small for it
+        int clampLevel(int level) const { return ofClamp(level, 0, numLevels - 1); }
+        const cv::Mat& getLevel(int level) const { return levels[clampLevel(level)]; }
+        int getNumLevels() const { return numLevels; }
+        const cv::Rect& getRoi() const { return roi; }
+
+        // level pixel coordinates (centres at whole numbers) to full-frame ones
+        glm::vec2 toFrame(float x, float y, int level) const {
+            float scale = float(1 << level);
+            float center = (scale - 1) * 0.5f;
+            return glm::vec2(x * scale + center + roi.x, y * scale + center + roi.y);
+        }
+        static float toFrameLength(float length, int level) { return length * float(1 << level); }
+
+    protected:
+        cv::Rect roi;
+        int numLevels = 0;
+        vector<cv::Mat> levels; // level 0 is a view of the frame unless it's masked
+        cv::Mat masked;
+        vector<AreaDownsampler> downsamplers; // one per level, each keeps its own tables
+
+};
@@ -0,0 +1,90 @@
+#include "RawDumpSource.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+RawDumpSource::~RawDumpSource() {
+    close();
+}
+
+bool RawDumpSource::setup(int _width, int _height, bool _color) {
+    width = _width;
+    height = _height;
+    color = _color;
+
+    string fullPath = ofToDataPath(path, true);
+    fd = open(fullPath.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(FrameDumpHeader)) {
+        ofLogError("RawDumpSource") << "can't open " << path;
+        close();
+        return false;
+    }
+
+    size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ofLogError("RawDumpSource") << "can't map " << path;
+        close();
+        return false;
+    }
+    data = static_cast<const uint8_t*>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    memcpy(&header, data, sizeof(FrameDumpHeader));
+    if (!header.isValid() || header.numFrames == 0 || size < header.recordOffset(header.numFrames)) {
+        ofLogError("RawDumpSource") << path << " isn't a frame dump, or it's empty or truncated";
+        close();
+        return false;
+    }
+
+    // the dump's own span sets the loop length and the nominal frame rate
+    const FrameDumpRecord* oldest = reinterpret_cast<const FrameDumpRecord*>(data + header.recordOffset(header.first));
+    const FrameDumpRecord* newest = reinterpret_cast<const FrameDumpRecord*>(data + header.recordOffset((header.first + header.numFrames - 1) % header.numFrames));
+    int64_t span = newest->timestamp - oldest->timestamp;
+    framerate = header.numFrames > 1 && span > 0 ? (header.numFrames - 1) * 1000.0f / span : 0;
+    loopLength = span + (header.numFrames > 1 ? span / (header.numFrames - 1) : 0);
+
+    if (header.width != width || header.height != height || header.channels != (color ? 3 : 1)) {
+        ofLogNotice("RawDumpSource") << "dump is " << header.width << "x" << header.height << "x" << header.channels << ", converting every frame";
+    }
+    return true;
+}
+
+void RawDumpSource::close() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    if (fd >= 0) ::close(fd);
+    data = nullptr;
+    fd = -1;
+}
+
+bool RawDumpSource::grab(cv::Mat& frame) {
+    if (finished || !data) return false;
+
+    if (played >= header.numFrames) {
+        if (!loop) {
+            finished = true;
+            return false;
+        }
+        played = 0;
+        loopOffset += loopLength;
+    }
+
+    const uint8_t* record = data + header.recordOffset((header.first + played) % header.numFrames);
+    played++;
+
+    lastTimestamp = reinterpret_cast<const FrameDumpRecord*>(record)->timestamp + loopOffset;
+
+    // wraps the mapped pixels, nothing is copied until fit()
+    cv::Mat mapped(header.height, header.width, header.channels == 3 ? CV_8UC3 : CV_8UC1, const_cast<uint8_t*>(record + sizeof(FrameDumpRecord)));
+    fit(mapped, frame);
+    advance();
+    return true;
+}
+
+bool RawDumpSource::getTimestamp(int& timestamp) const {
+    timestamp = int(lastTimestamp);
+    return true;
+}
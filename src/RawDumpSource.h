@@ -0,0 +1,35 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "FrameDump.h"
+
+// Replays a raw frame dump (see FrameDump.h) straight out of a read-only memory map, so
+// there is no decoding cost at all. Frames keep the timestamps they were recorded with;
+// each loop is shifted by the length of the dump so they keep increasing.
+class RawDumpSource : public ReplaySource {
+
+    public:
+        RawDumpSource(const string& path) : path(path) { }
+        ~RawDumpSource();
+
+        bool setup(int width, int height, bool color) override;
+        void close() override;
+        bool grab(cv::Mat& frame) override;
+        bool getTimestamp(int& timestamp) const override;
+        string getName() const override { return "raw " + path; }
+        float getFramerate() const override { return framerate; }
+
+    protected:
+        string path;
+        int fd = -1;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        FrameDumpHeader header;
+
+        uint32_t played = 0; // records played in this loop
+        int64_t loopOffset = 0;
+        int64_t loopLength = 0;
+        int64_t lastTimestamp = 0;
+        float framerate = 0;
+
+};
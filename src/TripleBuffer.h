@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer.
+// The producer always owns a back slot it can fill without waiting, publish() swaps it
+// with the shared middle slot, and consume() swaps the middle slot to the front if it
+// holds something newer. A published slot that is overwritten before the consumer picks
+// it up is a dropped frame; publish() reports that so the producer can count it.
+template <typename T>
+class TripleBuffer {
+
+    public:
+        TripleBuffer() : middle(1), backIndex(0), frontIndex(2) { }
+
+        // direct slot access, only for preallocating before the producer starts
+        T& slot(int i) { return slots[i]; }
+
+        // producer side
+        T& back() { return slots[backIndex]; }
+
+        bool publish() { // returns true if an unconsumed slot was overwritten
+            uint8_t prev = middle.exchange(backIndex | DIRTY, std::memory_order_acq_rel);
+            backIndex = prev & INDEX_MASK;
+            return (prev & DIRTY) != 0;
+        }
+
+        // true while the last publish hasn't been consumed yet
+        bool isPending() const {
+            return (middle.load(std::memory_order_acquire) & DIRTY) != 0;
+        }
+
+        // consumer side
+        bool consume() { // returns true if front() now holds a new slot
+            if ((middle.load(std::memory_order_acquire) & DIRTY) == 0) return false;
+            uint8_t prev = middle.exchange(frontIndex, std::memory_order_acq_rel);
+            frontIndex = prev & INDEX_MASK;
+            return true;
+        }
+
+        T& front() { return slots[frontIndex]; }
+
+    private:
+        static const uint8_t INDEX_MASK = 0x3;
+        static const uint8_t DIRTY = 0x4;
+
+        T slots[3];
+        std::atomic<uint8_t> middle; // index of the shared slot, plus DIRTY when it holds an unconsumed publish
+        uint8_t backIndex; // producer only
+        uint8_t frontIndex; // consumer only
+
+};
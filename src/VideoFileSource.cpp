@@ -0,0 +1,38 @@
+#include "VideoFileSource.h"
+
+bool VideoFileSource::setup(int _width, int _height, bool _color) {
+    width = _width;
+    height = _height;
+    color = _color;
+
+    if (!capture.open(ofToDataPath(path, true))) {
+        ofLogError("VideoFileSource") << "can't open " << path;
+        return false;
+    }
+    fileFramerate = capture.get(cv::CAP_PROP_FPS);
+    return true;
+}
+
+void VideoFileSource::close() {
+    capture.release();
+}
+
+bool VideoFileSource::grab(cv::Mat& frame) {
+    if (finished || !capture.isOpened()) return false;
+
+    if (!capture.read(decoded)) {
+        if (!loop || frameIndex == 0) {
+            finished = true;
+            return false;
+        }
+        capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+        if (!capture.read(decoded)) {
+            finished = true;
+            return false;
+        }
+    }
+
+    fit(decoded, frame);
+    advance();
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "FrameSource.h"
+
+// Replays a video file through OpenCV's decoder, which needs no GL context and so also
+// works in headless builds.
+class VideoFileSource : public ReplaySource {
+
+    public:
+        VideoFileSource(const string& path) : path(path) { }
+
+        bool setup(int width, int height, bool color) override;
+        void close() override;
+        bool grab(cv::Mat& frame) override;
+        string getName() const override { return "video " + path; }
+        float getFramerate() const override { return fileFramerate; }
+
+    protected:
+        string path;
+        cv::VideoCapture capture;
+        cv::Mat decoded;
+        float fileFramerate = 0;
+
+};
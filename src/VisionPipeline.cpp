@@ -0,0 +1,409 @@
+#include "VisionPipeline.h"
+#include "Metrics.h"
+
+using namespace ofxCv;
+
+#define PIPELINE_POOL_SIZE 8 // enough for every queue to be full plus the job held by draw()
+#define PIPELINE_QUEUE_SIZE 2
+
+VisionPipeline::~VisionPipeline() {
+    stop();
+}
+
+void VisionPipeline::setup(FrameGrabber& _grabber, const Settings& _settings) {
+    grabber = &_grabber;
+    settings = _settings;
+
+    pool.clear();
+    for (int i = 0; i < PIPELINE_POOL_SIZE; i++) {
+        pool.push_back(make_shared<FrameJob>());
+    }
+
+    analyzeQueue.setCapacity(PIPELINE_QUEUE_SIZE);
+    serializeQueue.setCapacity(PIPELINE_QUEUE_SIZE);
+    sendQueue.setCapacity(PIPELINE_QUEUE_SIZE);
+
+    // only as deep as the deepest analysis that's on
+    pyramidSettings.roi = settings.roi;
+    pyramidSettings.mask = settings.mask;
+    pyramidSettings.levels = 0;
+    if (settings.blobs) pyramidSettings.levels = max(pyramidSettings.levels, settings.blobsLevel);
+    if (settings.contours) pyramidSettings.levels = max(pyramidSettings.levels, settings.contoursLevel);
+    if (settings.brightestPixel) pyramidSettings.levels = max(pyramidSettings.levels, settings.brightestPixelLevel);
+
+    // sizes are in full-frame pixels, the finders work in their level's
+    float blobsScale = ProcessingPyramid::toFrameLength(1, settings.blobsLevel);
+    blobFinder.setMinAreaRadius(settings.contourMinAreaRadius / blobsScale);
+    blobFinder.setMaxAreaRadius(settings.contourMaxAreaRadius / blobsScale);
+    if (settings.blobTracking) {
+        BlobTracker::Settings trackerSettings;
+        trackerSettings.thresholdValue = settings.thresholdValue;
+        trackerSettings.contourThreshold = settings.contourThreshold;
+        trackerSettings.minAreaRadius = settings.contourMinAreaRadius / blobsScale;
+        trackerSettings.maxAreaRadius = settings.contourMaxAreaRadius / blobsScale;
+        trackerSettings.roiMargin = max(int(settings.trackingRoiMargin / blobsScale), 1);
+        trackerSettings.fullScanInterval = settings.trackingFullScanInterval;
+        trackerSettings.persistence = settings.trackingPersistence;
+        trackerSettings.maxDistance = settings.trackingMaxDistance / blobsScale;
+        blobTracker.setup(trackerSettings);
+    }
+    if (settings.changeDetection) {
+        ChangeDetector::Settings changeSettings;
+        changeSettings.downsample = settings.changeDownsample;
+        changeSettings.tileSize = settings.changeTileSize;
+        changeSettings.threshold = settings.changeThreshold;
+        changeSettings.nearThreshold = settings.changeNearThreshold;
+        changeSettings.minTiles = settings.changeMinTiles;
+        changeSettings.keepAlive = settings.changeKeepAlive;
+        changeDetector.setup(changeSettings);
+    }
+
+    FrameScheduler::Settings schedulerSettings;
+    schedulerSettings.features[FrameScheduler::BLOBS] = { settings.blobs, settings.blobsRate, settings.blobsPriority };
+    schedulerSettings.features[FrameScheduler::CONTOURS] = { settings.contours, settings.contoursRate, settings.contoursPriority };
+    schedulerSettings.features[FrameScheduler::BRIGHTEST_PIXEL] = { settings.brightestPixel, settings.brightestPixelRate, settings.brightestPixelPriority };
+    schedulerSettings.features[FrameScheduler::SYNC_VIDEO] = { settings.syncVideo, settings.syncVideoRate, settings.syncVideoPriority };
+    schedulerSettings.loadShedding = settings.loadShedding;
+    schedulerSettings.budgetMillis = settings.frameBudget;
+    schedulerSettings.contourSlices = settings.contourSlices;
+    schedulerSettings.videoQualitySteps = settings.videoQualitySteps;
+    scheduler.setup(schedulerSettings);
+
+    if (settings.contours) {
+        float contoursScale = ProcessingPyramid::toFrameLength(1, settings.contoursLevel);
+        contourSlicer.setup(settings.contourSlices, settings.contourMinAreaRadius / contoursScale, settings.contourMaxAreaRadius / contoursScale, settings.simplify / contoursScale, settings.smooth, settings.contourThreads);
+    }
+}
+
+void VisionPipeline::start() {
+    if (running) return;
+    running = true;
+
+    analyzeQueue.reopen();
+    serializeQueue.reopen();
+    sendQueue.reopen();
+
+    // the analyze thread runs one analysis itself, the pool picks up the others
+    workers.setup(2);
+
+    threads.emplace_back(&VisionPipeline::convertLoop, this);
+    threads.emplace_back(&VisionPipeline::analyzeLoop, this);
+    threads.emplace_back(&VisionPipeline::serializeLoop, this);
+    threads.emplace_back(&VisionPipeline::sendLoop, this);
+}
+
+void VisionPipeline::stop() {
+    if (!running) return;
+    running = false;
+
+    analyzeQueue.close();
+    serializeQueue.close();
+    sendQueue.close();
+
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+    workers.stop();
+    contourSlicer.stop();
+}
+
+bool VisionPipeline::getLatestResult(shared_ptr<const FrameJob>& result) {
+    std::lock_guard<std::mutex> lock(resultMutex);
+    if (!latestResult) return false;
+    result = latestResult;
+    return true;
+}
+
+bool VisionPipeline::waitForResult(shared_ptr<const FrameJob>& result, int timeoutMillis) {
+    // the caller's reference keeps its job out of the pool, so a new result is a different pointer
+    std::unique_lock<std::mutex> lock(resultMutex);
+    resultArrived.wait_for(lock, std::chrono::milliseconds(timeoutMillis), [&]() { return latestResult && latestResult != result; });
+    if (!latestResult || latestResult == result) return false;
+    result = latestResult;
+    return true;
+}
+
+shared_ptr<FrameJob> VisionPipeline::acquireJob() {
+    // a job is free when the pool holds the only reference to it
+    for (auto& job : pool) {
+        if (job.use_count() == 1) return job;
+    }
+    return nullptr;
+}
+
+// ~ ~ ~ STAGES ~ ~ ~
+void VisionPipeline::convertLoop() {
+    while (running) {
+        Frame* frame;
+        if (!grabber->waitForLatest(frame, 100)) continue;
+        if (onFrame) onFrame(*frame);
+
+        // decided before a job is taken, so an unchanged frame costs no conversion and
+        // never counts as a pipeline drop; onFrame has already seen it for the streams
+        if (settings.changeDetection && !hasChanged(*frame)) {
+            framesUnchanged++;
+            Metrics::get().add(Metrics::FRAMES_UNCHANGED);
+            continue;
+        }
+
+        shared_ptr<FrameJob> job = acquireJob();
+        while (!job && settings.lossless && running) {
+            ofSleepMillis(1);
+            job = acquireJob();
+        }
+        if (!job) {
+            framesDropped++;
+            Metrics::get().add(Metrics::DROPPED_PIPELINE);
+            continue;
+        }
+
+        convert(*frame, *job);
+
+        if (onConverted) onConverted(*job);
+
+        scheduler.plan(ofGetElapsedTimeMicros(), job->plan);
+        if (job->plan.shedLevel > 0) Metrics::get().add(Metrics::FRAMES_SHED);
+
+        // a newer frame is better than a queued stale one, so never wait on analysis,
+        // except when replaying every frame matters more than keeping up
+        bool queued = settings.lossless ? analyzeQueue.push(job) : analyzeQueue.tryPush(job);
+        if (!queued) {
+            framesDropped++;
+            Metrics::get().add(Metrics::DROPPED_PIPELINE);
+        } else {
+            scheduler.charge(job->plan);
+            if (settings.changeDetection) changeDetector.commit(); // only a frame that will be analysed becomes the reference
+        }
+
+        Metrics& metrics = Metrics::get();
+        metrics.set(Metrics::QUEUE_ANALYZE, analyzeQueue.size());
+        metrics.set(Metrics::QUEUE_SERIALIZE, serializeQueue.size());
+        metrics.set(Metrics::QUEUE_SEND, sendQueue.size());
+        metrics.set(Metrics::SHED_LEVEL, scheduler.getShedLevel());
+    }
+}
+
+bool VisionPipeline::hasChanged(const Frame& frame) {
+    ScopedMetric metric(Metrics::CHANGE_DETECT);
+
+    // a change near something already found matters more than one elsewhere
+    resultRegions.clear();
+    shared_ptr<const FrameJob> previous;
+    if (getLatestResult(previous)) {
+        if (previous->hasBlobs) {
+            for (auto& blob : previous->blobs) {
+                resultRegions.emplace_back(blob.center.x - blob.radius, blob.center.y - blob.radius, blob.radius * 2, blob.radius * 2);
+            }
+        }
+        if (previous->hasContours) {
+            for (int i = 0; i < previous->numContours; i++) {
+                auto& points = previous->contours[i].points;
+                if (points.empty()) continue;
+                float minX = points[0].x, minY = points[0].y, maxX = minX, maxY = minY;
+                for (auto& point : points) {
+                    minX = min(minX, point.x);
+                    minY = min(minY, point.y);
+                    maxX = max(maxX, point.x);
+                    maxY = max(maxY, point.y);
+                }
+                resultRegions.emplace_back(minX, minY, maxX - minX + 1, maxY - minY + 1);
+            }
+        }
+        if (previous->hasPixel) {
+            if (previous->peaks.empty()) {
+                resultRegions.emplace_back(previous->pixel.x - 1, previous->pixel.y - 1, 3, 3);
+            } else {
+                for (auto& peak : previous->peaks) resultRegions.emplace_back(peak.cx - 1, peak.cy - 1, 3, 3);
+            }
+        }
+    }
+
+    return changeDetector.update(frame.mat, resultRegions, ofGetElapsedTimeMicros());
+}
+
+void VisionPipeline::buildPyramid(FrameJob& job) {
+    ScopedMetric metric(Metrics::PYRAMID);
+    job.pyramid.build(job.frame, pyramidSettings);
+}
+
+void VisionPipeline::convert(const Frame& frame, FrameJob& job) {
+    ScopedMetric metric(Metrics::CONVERT);
+
+    job.seq = frame.seq;
+    job.timestamp = frame.timestamp;
+    job.grabMicros = frame.grabMicros;
+    job.buffer = frame.buffer;
+    job.frame = frame.mat;
+    job.pixels.setFromExternalPixels(frame.buffer->pixels.getData(), frame.mat.cols, frame.mat.rows, frame.mat.channels());
+
+    job.hasBlobs = false;
+    job.hasContours = false;
+    job.hasPixel = false;
+    job.hasVideo = false;
+}
+
+void VisionPipeline::analyzeLoop() {
+    shared_ptr<FrameJob> job;
+    vector<std::function<void()>> tasks;
+
+    while (analyzeQueue.pop(job)) {
+        FrameJob& j = *job;
+        j.analyzeMicros = ofGetElapsedTimeMicros();
+        buildPyramid(j);
+        tasks.clear();
+        if (settings.blobs && j.plan.run[FrameScheduler::BLOBS]) tasks.push_back([this, &j]() { findBlobs(j); });
+        if (settings.contours && j.plan.run[FrameScheduler::CONTOURS]) tasks.push_back([this, &j]() { findContours(j); });
+        if (settings.brightestPixel && j.plan.run[FrameScheduler::BRIGHTEST_PIXEL]) tasks.push_back([this, &j]() { findBrightestPixel(j); });
+        {
+            ScopedMetric metric(Metrics::ANALYZE);
+            workers.run(tasks);
+        }
+
+        if (!serializeQueue.push(job)) break;
+        job.reset();
+    }
+}
+
+void VisionPipeline::serializeLoop() {
+    shared_ptr<FrameJob> job;
+
+    while (serializeQueue.pop(job)) {
+        {
+            ScopedMetric metric(Metrics::SERIALIZE);
+            if (job->hasContours && settings.packContours) packContours(*job);
+            if (settings.syncVideo && job->plan.run[FrameScheduler::SYNC_VIDEO] && onSerialize) onSerialize(*job);
+        }
+        scheduler.report(ofGetElapsedTimeMicros() - job->analyzeMicros);
+
+        if (!sendQueue.push(job)) break;
+        job.reset();
+    }
+}
+
+void VisionPipeline::sendLoop() {
+    shared_ptr<FrameJob> job;
+
+    while (sendQueue.pop(job)) {
+        if (onSend) onSend(*job);
+        framesProcessed++;
+        Metrics::get().add(Metrics::FRAMES_PROCESSED);
+        Metrics::get().record(Metrics::FRAME, ofGetElapsedTimeMicros() - job->grabMicros);
+
+        {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            latestResult = job;
+        }
+        resultArrived.notify_all();
+        job.reset();
+    }
+}
+
+// ~ ~ ~ ANALYSES ~ ~ ~
+void VisionPipeline::findBlobs(FrameJob& job) {
+    ScopedMetric metric(Metrics::BLOBS);
+    int level = job.pyramid.clampLevel(settings.blobsLevel);
+    const cv::Mat& view = job.pyramid.getLevel(level);
+
+    if (settings.blobTracking) {
+        blobTracker.track(view, job);
+    } else {
+        //autothreshold(job.processed);
+        cv::threshold(view, job.processed, settings.thresholdValue, 255, 0);
+        blobFinder.setThreshold(settings.contourThreshold);
+        blobFinder.findContours(job.processed);
+
+        int n = blobFinder.size();
+        job.blobs.resize(n);
+        for (int i = 0; i < n; i++) {
+            BlobResult& blob = job.blobs[i];
+            blob.index = i;
+            blob.center = toOf(blobFinder.getMinEnclosingCircle(i, blob.radius));
+        }
+    }
+
+    for (auto& blob : job.blobs) {
+        blob.center = job.pyramid.toFrame(blob.center.x, blob.center.y, level);
+        blob.radius = ProcessingPyramid::toFrameLength(blob.radius, level);
+    }
+    job.hasBlobs = true;
+}
+
+void VisionPipeline::findContours(FrameJob& job) {
+    ScopedMetric metric(Metrics::CONTOURS);
+    int level = job.pyramid.clampLevel(settings.contoursLevel);
+    contourSlicer.find(job, job.pyramid.getLevel(level));
+
+    for (int i = 0; i < job.numContours; i++) {
+        for (auto& point : job.contours[i].points) {
+            glm::vec2 mapped = job.pyramid.toFrame(point.x, point.y, level);
+            point.x = mapped.x;
+            point.y = mapped.y;
+        }
+    }
+    job.hasContours = true;
+}
+
+void VisionPipeline::findBrightestPixel(FrameJob& job) {
+    ScopedMetric metric(Metrics::BRIGHTEST_PIXEL);
+
+    // this mostly useful as a performance baseline
+    // https://openframeworks.cc/ofBook/chapters/image_processing_computer_vision.html
+    int level = job.pyramid.clampLevel(settings.brightestPixelLevel);
+    const cv::Mat& view = job.pyramid.getLevel(level);
+    const uint8_t* data = view.ptr<uint8_t>();
+    int channels = view.channels();
+    int stride = view.step;
+
+    PeakFinder::Peak brightest;
+    if (settings.peaks > 1) {
+        int distance = max(int(settings.peakDistance / ProcessingPyramid::toFrameLength(1, level)), 1);
+        peakFinder.findPeaks(data, view.cols, view.rows, channels, stride, settings.thresholdValue, settings.peaks, distance, job.peaks);
+        for (auto& peak : job.peaks) {
+            glm::vec2 center = job.pyramid.toFrame(peak.cx, peak.cy, level);
+            glm::vec2 pixel = job.pyramid.toFrame(peak.x, peak.y, level);
+            peak.cx = center.x;
+            peak.cy = center.y;
+            peak.x = pixel.x;
+            peak.y = pixel.y;
+        }
+        if (!job.peaks.empty()) brightest = job.peaks[0];
+    } else {
+        job.peaks.clear();
+        if (PeakFinder::findBrightest(data, view.cols, view.rows, channels, stride, settings.thresholdValue, brightest)) {
+            glm::vec2 pixel = job.pyramid.toFrame(brightest.x, brightest.y, level);
+            brightest.x = pixel.x;
+            brightest.y = pixel.y;
+        }
+    }
+
+    // whole pixels, as before; nothing above threshold still reports 0, 0.
+    // the subpixel centroids only go out with the top-K peaks
+    job.pixel.x = brightest.x;
+    job.pixel.y = brightest.y;
+    job.pixel.brightness = brightest.value;
+    job.hasPixel = true;
+}
+
+// ~ ~ ~ SERIALIZATION ~ ~ ~
+void VisionPipeline::packContours(FrameJob& job) {
+    for (int i = 0; i < job.numContours; i++) {
+        ContourResult& contour = job.contours[i];
+
+        float colorData[3];
+        colorData[0] = contour.color.r;
+        colorData[1] = contour.color.g;
+        colorData[2] = contour.color.b;
+        contour.colorBuffer.set(reinterpret_cast<const char *>(colorData), sizeof colorData);
+
+        // the buffers keep their capacity from frame to frame, so the points are written
+        // straight into them and nothing is allocated or copied twice
+        size_t numFloats = contour.points.size() * 3;
+        contour.pointsBuffer.allocate(numFloats * sizeof(float));
+        float* pointsData = reinterpret_cast<float *>(contour.pointsBuffer.getData());
+        for (int j=0; j<contour.points.size(); j++) {
+            int index = j * 3;
+            pointsData[index] = contour.points[j].x;
+            pointsData[index+1] = contour.points[j].y;
+            pointsData[index+2] = contour.points[j].z;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FrameGrabber.h"
+#include "FrameJob.h"
+#include "BoundedQueue.h"
+#include "WorkerPool.h"
+#include "ContourSlicer.h"
+#include "BlobTracker.h"
+#include "ChangeDetector.h"
+#include "FrameScheduler.h"
+
+// Runs the per-frame work off the render loop, as four stages on their own threads:
+//   convert   - pull the newest frame from the grabber into a pooled job
+//   analyze   - build the frame's ProcessingPyramid, then blobs, contours and brightest
+//               pixel in parallel, each on its own pyramid level
+//   serialize - pack contours and encode the sync video thumbnail
+//   send      - OSC / WebSocket output
+// Stages are connected by bounded queues. If every pooled job is busy, the convert stage
+// drops the frame rather than stalling the grabber, unless it's lossless (replay), where it
+// waits instead and the grabber waits on it in turn. With change detection on, frames that
+// don't differ from the last analysed one stop before taking a job (see ChangeDetector.h).
+// Every frame that goes on to analysis gets a plan from the FrameScheduler saying which
+// analyses run on it, at their own rates, and how much is shed under load.
+class VisionPipeline {
+
+    public:
+        struct Settings {
+            bool blobs = true;
+            bool contours = false;
+            bool brightestPixel = false;
+            bool syncVideo = false;
+            bool packContours = true; // per-contour buffers for the per-item messages, not needed when batching
+            bool lossless = false; // replay: wait for a free job and for analysis instead of dropping frames
+
+            int thresholdValue = 127;
+            float contourThreshold = 2.0;
+            float contourMinAreaRadius = 1.0;
+            float contourMaxAreaRadius = 250.0;
+            int contourSlices = 10;
+            float simplify = 0.5;
+            int smooth = 2;
+            int contourThreads = 3; // threads the contour slices are spread across
+            int peaks = 1; // brightest pixel: how many separated peaks to find
+            int peakDistance = 20; // minimum distance between peaks, in pixels
+
+            bool blobTracking = false; // stable blob ids, searching only around known blobs
+            int trackingRoiMargin = 20;
+            int trackingFullScanInterval = 30;
+            int trackingPersistence = 15;
+            float trackingMaxDistance = 64;
+
+            bool changeDetection = false; // skip analyses and sends while the scene is static
+            int changeThreshold = 8;
+            int changeNearThreshold = 4;
+            int changeDownsample = 4;
+            int changeTileSize = 8;
+            int changeMinTiles = 1;
+            float changeKeepAlive = 1.0;
+
+            // per analysis rates (per second, 0 for every frame) and priorities, see FrameScheduler.h
+            float blobsRate = 0, contoursRate = 0, brightestPixelRate = 0, syncVideoRate = 0;
+            int blobsPriority = 3, contoursPriority = 0, brightestPixelPriority = 2, syncVideoPriority = 1;
+            bool loadShedding = false; // degrade low priority work when frames go over budget
+            float frameBudget = 33; // ms from the start of the analyses to the end of serialization
+            int videoQualitySteps = 2; // sync video quality levels that may be shed
+
+            // what the analyses look at, see ProcessingPyramid.h; results are always in full-frame pixels
+            cv::Rect roi; // empty for the whole frame
+            cv::Mat mask; // frame sized, 0 where nothing should be found; empty for none
+            int blobsLevel = 0, contoursLevel = 0, brightestPixelLevel = 0; // halvings, 0 for full resolution
+        };
+
+        ~VisionPipeline();
+
+        void setup(FrameGrabber& grabber, const Settings& settings);
+        void start();
+        void stop();
+
+        // hooks into the app, each called on its stage's thread
+        std::function<void(const Frame&)> onFrame; // every frame taken from the grabber, before any gating or drops
+        std::function<void(FrameJob&)> onConverted; // every converted job, before it's queued for analysis
+        std::function<void(FrameJob&)> onSerialize; // e.g. thumbnail encoding
+        std::function<void(FrameJob&)> onSend;
+
+        // newest job that made it through every stage, for drawing. Returns false if there is none yet.
+        bool getLatestResult(shared_ptr<const FrameJob>& result);
+        // as getLatestResult, but sleeps up to timeoutMillis for one newer than result
+        bool waitForResult(shared_ptr<const FrameJob>& result, int timeoutMillis);
+
+        uint64_t getFramesProcessed() const { return framesProcessed.load(); }
+        uint64_t getFramesDropped() const { return framesDropped.load(); }
+        uint64_t getFramesUnchanged() const { return framesUnchanged.load(); }
+        const ContourSlicer& getContourSlicer() const { return contourSlicer; }
+        const BlobTracker& getBlobTracker() const { return blobTracker; }
+        const FrameScheduler& getScheduler() const { return scheduler; }
+
+    protected:
+        void convertLoop();
+        void analyzeLoop();
+        void serializeLoop();
+        void sendLoop();
+
+        shared_ptr<FrameJob> acquireJob();
+        bool hasChanged(const Frame& frame);
+        void buildPyramid(FrameJob& job);
+
+        // the work of each stage, also driven directly by the benchmark in bench/
+        void convert(const Frame& frame, FrameJob& job);
+        void findBlobs(FrameJob& job);
+        void findContours(FrameJob& job);
+        void findBrightestPixel(FrameJob& job);
+        void packContours(FrameJob& job);
+
+        FrameGrabber* grabber = nullptr;
+        Settings settings;
+
+        vector<shared_ptr<FrameJob>> pool;
+        BoundedQueue<shared_ptr<FrameJob>> analyzeQueue, serializeQueue, sendQueue;
+        WorkerPool workers;
+
+        // analyses run concurrently, so each gets its own finder
+        ofxCv::ContourFinder blobFinder;
+        BlobTracker blobTracker;
+        ContourSlicer contourSlicer;
+        PeakFinder peakFinder;
+        ChangeDetector changeDetector; // convert thread only
+        ProcessingPyramid::Settings pyramidSettings;
+        FrameScheduler scheduler;
+        vector<cv::Rect> resultRegions;
+
+        std::mutex resultMutex;
+        std::condition_variable resultArrived;
+        shared_ptr<const FrameJob> latestResult;
+
+        vector<std::thread> threads;
+        std::atomic<bool> running { false };
+        std::atomic<uint64_t> framesProcessed { 0 };
+        std::atomic<uint64_t> framesDropped { 0 };
+        std::atomic<uint64_t> framesUnchanged { 0 };
+
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+// Header-only reader for the compact wire format described in WireFormat.h.
+// No openFrameworks dependency, so receivers can drop this file into their own projects.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct WireBlob {
+    int index;
+    float x, y, radius;
+};
+
+struct WireContour {
+    uint8_t r, g, b, brightness;
+    std::vector<float> points; // x, y pairs
+};
+
+struct WirePixel {
+    float x, y;
+    uint8_t brightness;
+};
+
+struct WirePacket {
+    int version = 0;
+    int type = 0; // 1 blobs, 2 contours, 3 pixels
+    uint64_t seq = 0;
+    int64_t timestamp = 0;
+    int total = 0; // items in the whole frame
+    int part = 0;
+    int parts = 0;
+
+    std::vector<WireBlob> blobs;
+    std::vector<WireContour> contours;
+    std::vector<WirePixel> pixels;
+};
+
+class WireReader {
+
+    public:
+        WireReader(const uint8_t* data, size_t size) : p(data), end(data + size) { }
+
+        bool ok() const { return !failed; }
+
+        // the next unread byte, e.g. where the header ends and the records begin
+        const uint8_t* position() const { return p; }
+
+        uint8_t byte() {
+            if (p >= end) {
+                failed = true;
+                return 0;
+            }
+            return *p++;
+        }
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t b = byte();
+                value |= uint64_t(b & 0x7f) << shift;
+                if ((b & 0x80) == 0) return value;
+            }
+            failed = true;
+            return 0;
+        }
+
+        int64_t svarint() {
+            uint64_t v = varint();
+            return int64_t(v >> 1) ^ -int64_t(v & 1);
+        }
+
+    private:
+        const uint8_t* p;
+        const uint8_t* end;
+        bool failed = false;
+
+};
+
+// returns false on a truncated or foreign packet
+inline bool decodeWirePacket(const uint8_t* data, size_t size, WirePacket& packet) {
+    WireReader in(data, size);
+
+    if (in.byte() != 'P' || in.byte() != 'W') return false;
+    packet.version = in.byte();
+    if (packet.version != 1) return false;
+    packet.type = in.byte();
+    int fracBits = in.byte();
+    if (fracBits > 24) return false; // WireEncoder::MAX_FRAC_BITS; shifting by 31 or more is undefined
+    float scale = 1.0f / float(1 << fracBits);
+
+    packet.seq = in.varint();
+    packet.timestamp = in.svarint();
+    packet.total = in.varint();
+    packet.part = in.varint();
+    packet.parts = in.varint();
+    int count = in.varint();
+
+    packet.blobs.clear();
+    packet.contours.clear();
+    packet.pixels.clear();
+
+    for (int i = 0; i < count && in.ok(); i++) {
+        if (packet.type == 1) {
+            WireBlob blob;
+            blob.index = in.varint();
+            blob.x = in.svarint() * scale;
+            blob.y = in.svarint() * scale;
+            blob.radius = in.varint() * scale;
+            packet.blobs.push_back(blob);
+        } else if (packet.type == 2) {
+            WireContour contour;
+            contour.r = in.byte();
+            contour.g = in.byte();
+            contour.b = in.byte();
+            contour.brightness = in.byte();
+            uint64_t numPoints = in.varint();
+            if (numPoints > size) return false; // every point takes at least two bytes
+            contour.points.resize(numPoints * 2);
+            int64_t x = 0, y = 0;
+            for (uint64_t j = 0; j < numPoints; j++) {
+                x += in.svarint();
+                y += in.svarint();
+                contour.points[j * 2] = x * scale;
+                contour.points[j * 2 + 1] = y * scale;
+            }
+            packet.contours.push_back(std::move(contour));
+        } else if (packet.type == 3) {
+            WirePixel pixel;
+            pixel.x = in.svarint() * scale;
+            pixel.y = in.svarint() * scale;
+            pixel.brightness = in.byte();
+            packet.pixels.push_back(pixel);
+        } else {
+            return false;
+        }
+    }
+
+    return in.ok();
+}
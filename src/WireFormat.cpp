@@ -0,0 +1,111 @@
+#include "WireFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+const uint8_t WireEncoder::VERSION;
+const int WireEncoder::MAX_FRAC_BITS;
+
+void WireEncoder::putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+void WireEncoder::putSvarint(std::vector<uint8_t>& out, int64_t value) {
+    putVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63)); // zigzag
+}
+
+int32_t WireEncoder::quantize(float value) const {
+    return int32_t(std::lround(value * float(1 << fracBits)));
+}
+
+void WireEncoder::begin(Type _type, int _fracBits) {
+    type = _type;
+    fracBits = std::min(std::max(_fracBits, 0), MAX_FRAC_BITS);
+    records.clear();
+    itemStarts.clear();
+}
+
+void WireEncoder::addBlob(int index, float x, float y, float radius) {
+    itemStarts.push_back(records.size());
+    putVarint(records, index);
+    putSvarint(records, quantize(x));
+    putSvarint(records, quantize(y));
+    putVarint(records, radius > 0 ? quantize(radius) : 0);
+}
+
+void WireEncoder::beginContour(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness, int numPoints) {
+    itemStarts.push_back(records.size());
+    records.push_back(r);
+    records.push_back(g);
+    records.push_back(b);
+    records.push_back(brightness);
+    putVarint(records, numPoints);
+    pointIndex = 0;
+}
+
+void WireEncoder::addContourPoint(float x, float y) {
+    int32_t qx = quantize(x);
+    int32_t qy = quantize(y);
+    if (pointIndex == 0) {
+        putSvarint(records, qx);
+        putSvarint(records, qy);
+    } else {
+        putSvarint(records, qx - lastX);
+        putSvarint(records, qy - lastY);
+    }
+    lastX = qx;
+    lastY = qy;
+    pointIndex++;
+}
+
+void WireEncoder::addPixel(float x, float y, uint8_t brightness) {
+    itemStarts.push_back(records.size());
+    putSvarint(records, quantize(x));
+    putSvarint(records, quantize(y));
+    records.push_back(brightness);
+}
+
+size_t WireEncoder::recordOffset(int item) const {
+    return item < (int) itemStarts.size() ? itemStarts[item] : records.size();
+}
+
+int WireEncoder::split(size_t maxRecordBytes, std::vector<int>& partStarts) const {
+    partStarts.clear();
+    partStarts.push_back(0);
+
+    size_t partBegin = 0;
+    for (int i = 0; i < (int) itemStarts.size(); i++) {
+        if (recordOffset(i + 1) - partBegin > maxRecordBytes && itemStarts[i] > partBegin) {
+            partStarts.push_back(i);
+            partBegin = itemStarts[i];
+        }
+    }
+    return partStarts.size();
+}
+
+void WireEncoder::writePacket(std::vector<uint8_t>& out, uint64_t seq, int64_t timestamp) const {
+    writePacket(out, seq, timestamp, 0, 1, 0, getCount());
+}
+
+void WireEncoder::writePacket(std::vector<uint8_t>& out, uint64_t seq, int64_t timestamp, int part, int parts, int firstItem, int lastItem) const {
+    out.clear();
+    out.push_back('P');
+    out.push_back('W');
+    out.push_back(VERSION);
+    out.push_back(uint8_t(type));
+    out.push_back(uint8_t(fracBits));
+    putVarint(out, seq);
+    putSvarint(out, timestamp);
+    putVarint(out, getCount());
+    putVarint(out, part);
+    putVarint(out, parts);
+    putVarint(out, lastItem - firstItem);
+
+    size_t begin = recordOffset(firstItem);
+    size_t end = recordOffset(lastItem);
+    out.insert(out.end(), records.begin() + begin, records.begin() + end);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact binary wire format, version 1. Little-endian, no padding.
+//
+// packet:
+//   'P' 'W'           magic
+//   u8                version (1)
+//   u8                type: 1 blobs, 2 contours, 3 pixels
+//   u8                fracBits, 0-24: coordinates are fixed point, value = int / (1 << fracBits)
+//   varint            seq
+//   svarint           timestamp
+//   varint            total item count for the frame
+//   varint            part, varint parts (a frame may be split over several packets)
+//   varint            items in this packet
+//   records...
+//
+// records (all coordinates zigzag svarint fixed point):
+//   blob:    varint index, svarint x, svarint y, varint radius
+//   contour: u8 r, u8 g, u8 b, u8 brightness, varint numPoints,
+//            svarint x0, svarint y0, then svarint dx, dy from the previous point
+//   pixel:   svarint x, svarint y, u8 brightness
+//
+// Deltas are taken between quantized points, so decoding never drifts.
+// WireDecoder.h and DocumentRoot/js/wire.js read this.
+class WireEncoder {
+
+    public:
+        enum Type {
+            BLOBS = 1,
+            CONTOURS = 2,
+            PIXELS = 3
+        };
+
+        static const uint8_t VERSION = 1;
+        static const int MAX_FRAC_BITS = 24; // a float's mantissa; decoders reject anything more
+
+        void begin(Type type, int fracBits = 4);
+
+        void addBlob(int index, float x, float y, float radius);
+        void beginContour(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness, int numPoints);
+        void addContourPoint(float x, float y);
+        void addPixel(float x, float y, uint8_t brightness);
+
+        int getCount() const { return itemStarts.size(); }
+
+        // groups items into parts whose records fit in maxRecordBytes; returns the number of parts.
+        // An item bigger than that gets a part to itself.
+        int split(size_t maxRecordBytes, std::vector<int>& partStarts) const;
+
+        // writes a complete packet holding items [firstItem, lastItem) to out, replacing its contents
+        void writePacket(std::vector<uint8_t>& out, uint64_t seq, int64_t timestamp, int part, int parts, int firstItem, int lastItem) const;
+        void writePacket(std::vector<uint8_t>& out, uint64_t seq, int64_t timestamp) const;
+
+        static void putVarint(std::vector<uint8_t>& out, uint64_t value);
+        static void putSvarint(std::vector<uint8_t>& out, int64_t value);
+
+    protected:
+        int32_t quantize(float value) const;
+        size_t recordOffset(int item) const;
+
+        Type type = BLOBS;
+        int fracBits = 4;
+
+        // reused every frame so steady state doesn't allocate
+        std::vector<uint8_t> records;
+        std::vector<size_t> itemStarts;
+        int32_t lastX = 0;
+        int32_t lastY = 0;
+        int pointIndex = 0;
+
+};
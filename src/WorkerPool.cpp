@@ -0,0 +1,74 @@
+#include "WorkerPool.h"
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::setup(int numThreads) {
+    stop();
+    stopping = false;
+    for (int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+}
+
+void WorkerPool::run(std::vector<std::function<void()>>& tasks) {
+    if (tasks.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch = &tasks;
+        next = 0;
+        remaining = tasks.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(&tasks);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return remaining == 0 && active == 0; });
+    batch = nullptr;
+}
+
+void WorkerPool::drain(std::vector<std::function<void()>>* tasks) {
+    while (true) {
+        size_t i = next.fetch_add(1);
+        if (i >= tasks->size()) return;
+        (*tasks)[i]();
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+void WorkerPool::workerLoop() {
+    uint64_t seen = 0;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&]() { return stopping || (batch != nullptr && generation != seen); });
+        if (stopping) return;
+        seen = generation;
+        auto* tasks = batch;
+        active++;
+        lock.unlock();
+
+        drain(tasks);
+
+        lock.lock();
+        active--;
+        if (active == 0) done.notify_all();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A handful of long-lived threads for fork/join work on one frame.
+// run() hands out the tasks, helps execute them on the calling thread, and returns once
+// every task has finished, so the tasks can safely reference the caller's stack.
+class WorkerPool {
+
+    public:
+        ~WorkerPool();
+
+        void setup(int numThreads);
+        void stop();
+        void run(std::vector<std::function<void()>>& tasks);
+
+        int getNumThreads() const { return threads.size(); }
+
+    private:
+        void workerLoop();
+        void drain(std::vector<std::function<void()>>* tasks);
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wake, done;
+
+        std::vector<std::function<void()>>* batch = nullptr;
+        std::atomic<size_t> next { 0 };
+        std::atomic<size_t> remaining { 0 };
+        uint64_t generation = 0;
+        int active = 0; // workers currently holding a pointer to batch
+        bool stopping = false;
+
+};
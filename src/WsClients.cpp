@@ -0,0 +1,151 @@
+#include "WsClients.h"
+#include "Metrics.h"
+
+// frames handed to a connection before we wait for its frame sent events
+#define WS_MAX_IN_FLIGHT 2
+
+void WsClients::setup(int _maxQueue, int _maxFramerate, int _maxKbps, const vector<int>& _qualities) {
+    maxQueue = max(_maxQueue, 1);
+    maxFramerate = _maxFramerate;
+    maxKbps = _maxKbps;
+    qualities = _qualities;
+}
+
+void WsClients::onOpen(ofxHTTP::WebSocketConnection& connection) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Client& client = clients[&connection];
+    client.connection = &connection;
+    client.address = connection.clientAddress().toString();
+    client.pacer.setup(maxFramerate, maxKbps, qualities);
+    Metrics::get().set(Metrics::CLIENTS_WS, clients.size());
+}
+
+void WsClients::onClose(ofxHTTP::WebSocketConnection& connection) {
+    std::lock_guard<std::mutex> lock(mutex);
+    clients.erase(&connection);
+    Metrics::get().set(Metrics::CLIENTS_WS, clients.size());
+}
+
+void WsClients::onFrameSent(ofxHTTP::WebSocketConnection& connection, const ofxHTTP::WebSocketFrame& frame) {
+    Metrics& metrics = Metrics::get();
+    metrics.add(Metrics::MESSAGES_WS);
+    metrics.add(Metrics::BYTES_WS, frame.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = clients.find(&connection);
+    if (it == clients.end()) return;
+
+    // a connection sends in order, so one of our frames can only be the oldest in flight
+    Client& client = it->second;
+    if (client.inFlight.empty()) return;
+    const ofxHTTP::WebSocketFrame& oldest = (*client.inFlight.front().message)[client.inFlight.front().frame];
+    if (oldest.size() != frame.size() || memcmp(oldest.getData(), frame.getData(), frame.size()) != 0) return; // a helper's broadcast
+
+    uint64_t now = ofGetElapsedTimeMicros();
+    uint64_t latency = now - client.inFlight.front().micros;
+    client.pacer.onSent(frame.size(), latency);
+    client.inFlight.pop_front();
+    metrics.record(Metrics::SEND_WS, latency);
+
+    client.pacer.update(now, client.queue.size());
+    pump(client);
+}
+
+void WsClients::broadcast(const ofxHTTP::WebSocketFrame& frame, bool droppable) {
+    shared_ptr<Message> message = make_shared<Message>();
+    message->push_back(frame);
+    broadcast(message, droppable);
+}
+
+void WsClients::broadcast(shared_ptr<const Message> message, bool droppable) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& it : clients) {
+        enqueue(it.second, message, droppable);
+    }
+}
+
+void WsClients::broadcastVideo(std::function<shared_ptr<const Message>(int quality)> getMessage) {
+    uint64_t now = ofGetElapsedTimeMicros();
+
+    // decide who gets this frame, and at what quality, then encode outside the lock
+    receivers.clear();
+    variants.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& it : clients) {
+            Client& client = it.second;
+            if (!client.pacer.shouldSend(now)) continue;
+
+            int quality = client.pacer.getQuality();
+            receivers.push_back(make_pair(it.first, quality));
+            bool found = false;
+            for (auto& variant : variants) found = found || variant.first == quality;
+            if (!found) variants.push_back(make_pair(quality, shared_ptr<const Message>()));
+        }
+    }
+
+    if (receivers.empty()) return;
+    for (auto& variant : variants) variant.second = getMessage(variant.first);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& receiver : receivers) {
+        auto it = clients.find(receiver.first);
+        if (it == clients.end()) continue; // closed in the meantime
+        for (auto& variant : variants) {
+            if (variant.first == receiver.second && variant.second) enqueue(it->second, variant.second, true);
+        }
+    }
+}
+
+void WsClients::enqueue(Client& client, shared_ptr<const Message> message, bool droppable) {
+    size_t bytes = 0;
+    for (auto& frame : *message) bytes += frame.size();
+
+    if (droppable && (int) client.queue.size() >= maxQueue) {
+        // drop the oldest message that's allowed to go
+        for (auto it = client.queue.begin(); it != client.queue.end(); ++it) {
+            if (!it->droppable) continue;
+            size_t droppedBytes = 0;
+            for (auto& frame : *it->message) droppedBytes += frame.size();
+            client.pacer.onDropped(droppedBytes);
+            Metrics::get().add(Metrics::DROPPED_WS);
+            client.queue.erase(it);
+            break;
+        }
+    }
+
+    client.queue.push_back({ message, droppable });
+    client.pacer.onQueued(bytes);
+    pump(client);
+}
+
+void WsClients::pump(Client& client) {
+    while (!client.queue.empty() && client.inFlight.size() < WS_MAX_IN_FLIGHT) {
+        Entry entry = client.queue.front();
+        client.queue.pop_front();
+
+        uint64_t now = ofGetElapsedTimeMicros();
+        for (size_t i = 0; i < entry.message->size(); i++) {
+            client.inFlight.push_back({ now, entry.message, i });
+            client.connection->sendFrame((*entry.message)[i]);
+        }
+    }
+}
+
+int WsClients::getNumClients() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return clients.size();
+}
+
+void WsClients::getClientStats(vector<ClientStats>& stats) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& it : clients) {
+        const Client& client = it.second;
+        ClientStats s;
+        s.transport = "ws";
+        s.address = client.address;
+        s.queuedFrames = client.queue.size() + client.inFlight.size();
+        client.pacer.fillStats(s);
+        stats.push_back(s);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxHTTP.h"
+#include "ClientPacer.h"
+
+// Per-connection send queues for the WebSocket server, in place of
+// webSocketRoute().broadcast(), which hands every message to every client however slow
+// its link is. Each client gets at most MAX_IN_FLIGHT frames handed to its connection
+// at once; the rest wait in a queue of max_stream_queue messages that drops the oldest
+// when a new one arrives. Video is also paced per client by a ClientPacer, so a slow
+// client gets smaller, rarer thumbnails. Latency is the time from handing a frame to
+// the connection until its frame sent event.
+//
+// The per-item messages (batch_output off) still go out through the shared Pinopticon
+// helpers, which own that format and broadcast on the route directly. Their frames
+// share the connections, so a sent event only settles an in-flight frame if it is that
+// frame; anything else is counted as a helper message and leaves the queues alone.
+class WsClients {
+
+    public:
+        // frames that must arrive together, e.g. a text header and its binary jpeg
+        typedef vector<ofxHTTP::WebSocketFrame> Message;
+
+        void setup(int maxQueue, int maxFramerate, int maxKbps, const vector<int>& qualities);
+
+        // from the server's events
+        void onOpen(ofxHTTP::WebSocketConnection& connection);
+        void onClose(ofxHTTP::WebSocketConnection& connection);
+        void onFrameSent(ofxHTTP::WebSocketConnection& connection, const ofxHTTP::WebSocketFrame& frame);
+
+        // any thread. Droppable messages may be dropped for slow clients, the others always go out
+        void broadcast(const ofxHTTP::WebSocketFrame& frame, bool droppable = true);
+        void broadcast(shared_ptr<const Message> message, bool droppable = true);
+
+        // paced per client; getMessage is called once per jpeg quality that some client currently wants
+        void broadcastVideo(std::function<shared_ptr<const Message>(int quality)> getMessage);
+
+        int getNumClients();
+        void getClientStats(vector<ClientStats>& stats);
+
+    protected:
+        struct Entry {
+            shared_ptr<const Message> message;
+            bool droppable;
+        };
+
+        struct InFlight {
+            uint64_t micros; // handed to the connection
+            shared_ptr<const Message> message;
+            size_t frame; // index in message
+        };
+
+        struct Client {
+            ofxHTTP::WebSocketConnection* connection;
+            string address;
+            std::deque<Entry> queue;
+            std::deque<InFlight> inFlight; // frames the connection hasn't sent yet, in order
+            ClientPacer pacer;
+        };
+
+        void enqueue(Client& client, shared_ptr<const Message> message, bool droppable);
+        void pump(Client& client);
+
+        std::mutex mutex;
+        std::map<ofxHTTP::WebSocketConnection*, Client> clients;
+
+        int maxQueue = 1;
+        int maxFramerate = 30;
+        int maxKbps = 0;
+        vector<int> qualities;
+
+        // reused by broadcastVideo, which is only called from one thread
+        vector<pair<ofxHTTP::WebSocketConnection*, int>> receivers;
+        vector<pair<int, shared_ptr<const Message>>> variants;
+
+};
@@ -1,28 +1,59 @@
 #include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofxXmlSettings.h"
 #include "ofApp.h"
 
 //========================================================================
-int main() {
-	
+// pinopticam [--headless | --window]
+// without either, <headless> in settings.xml decides
+int main(int argc, char* argv[]) {
+	std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+
+	ofxXmlSettings settings;
+	settings.loadFile("settings.xml");
+	bool headless = (bool) settings.getValue("settings:headless", 0);
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--headless") {
+			headless = true;
+		} else if (arg == "--window") {
+			headless = false;
+		} else {
+			cerr << "usage: " << argv[0] << " [--headless | --window]" << endl;
+			return 1;
+		}
+	}
+
+	shared_ptr<ofApp> app = make_shared<ofApp>();
+	app->headless = headless;
+	app->launchTime = launchTime;
+
+	if (headless) {
+		// no display, no GL context: the loop only wakes for finished frames
+		ofRunApp(make_shared<ofAppNoWindow>(), app);
+		return ofRunMainLoop();
+	}
+
 	int w = 640;
 	int h = 480;
 	
 	// setup the GL context
 #ifdef TARGET_OPENGLES
-	ofGLESWindowSettings settings;
-	settings.glesVersion = 2;
-	settings.setSize(w, h);
-	ofCreateWindow(settings);
+	ofGLESWindowSettings windowSettings;
+	windowSettings.glesVersion = 2;
+	windowSettings.setSize(w, h);
+	ofCreateWindow(windowSettings);
 #else
-        ofGLFWWindowSettings settings;
-        settings.numSamples = 0;
-	settings.setSize(w, h);
-        ofCreateWindow(settings);                       
+        ofGLFWWindowSettings windowSettings;
+        windowSettings.numSamples = 0;
+	windowSettings.setSize(w, h);
+        ofCreateWindow(windowSettings);                       
 #endif
 
         // this kicks off the running of my app
         // can be OF_WINDOW or OF_FULLSCREEN
         // pass in width and height too:
-        ofRunApp( new ofApp());
+        return ofRunApp(app);
 
 }
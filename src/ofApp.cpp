@@ -12,24 +12,27 @@ using namespace Pinopticon;
 void ofApp::setup() {
     settings.loadFile("settings.xml");
     
-    ofSetVerticalSync(false);
-    ofHideCursor();
+    if (!headless) {
+        ofSetVerticalSync(false);
+        ofHideCursor();
+    }
 
     appFramerate = settings.getValue("settings:app_framerate", 60);
     camFramerate = settings.getValue("settings:cam_framerate", 30);
-    ofSetFrameRate(appFramerate);
+    // headless, update() sleeps until the pipeline finishes a frame, so don't throttle on top
+    ofSetFrameRate(headless ? 0 : appFramerate);
 
     syncVideoQuality = settings.getValue("settings:osc_video_quality", 3); 
     videoColor = (bool) settings.getValue("settings:video_color", 0); 
     
     width = settings.getValue("settings:width", 640);
     height = settings.getValue("settings:height", 480);
-    ofSetWindowShape(width, height);
+    if (!headless) ofSetWindowShape(width, height);
 
     thumbWidth = settings.getValue("settings:thumb_width", 120);
     thumbHeight = settings.getValue("settings:thumb_height", 90);
 
-    debug = (bool) settings.getValue("settings:debug", 1);
+    debug = (bool) settings.getValue("settings:debug", 1) && !headless;
 
     sendOsc = (bool) settings.getValue("settings:send_osc", 1); 
     sendWs = (bool) settings.getValue("settings:send_ws", 1); 
@@ -39,8 +42,14 @@ void ofApp::setup() {
     syncVideo = (bool) settings.getValue("settings:sync_video", 0); 
     blobs = (bool) settings.getValue("settings:blobs", 1);
     contours = (bool) settings.getValue("settings:contours", 0); 
+    blobTracking = (bool) settings.getValue("settings:blob_tracking", 0); 
+    changeDetection = (bool) settings.getValue("settings:change_detection", 0); 
+    loadShedding = (bool) settings.getValue("settings:load_shedding", 0); 
     contourSlices = settings.getValue("settings:contour_slices", 10); 
+    contourThreads = settings.getValue("settings:contour_threads", 3); 
     brightestPixel = (bool) settings.getValue("settings:brightest_pixel", 0); 
+    brightestPixelPeaks = settings.getValue("settings:brightest_pixel_peaks", 1); 
+    peakDistance = settings.getValue("settings:peak_distance", 20); 
 
     oscHost = settings.getValue("settings:osc_host", "127.0.0.1");
     oscPort = settings.getValue("settings:osc_port", 7110);
@@ -51,16 +60,13 @@ void ofApp::setup() {
     rpiCamVersion = settings.getValue("settings:rpi_cam_version", 1);
     stillCompression = settings.getValue("settings:still_compression", 100);
 
-    // camera
-    if (videoColor) {
-        gray.allocate(width, height, OF_IMAGE_COLOR);
-        grayThumbnail.allocate(width, height, OF_IMAGE_COLOR);
-    } else {
-        gray.allocate(width, height, OF_IMAGE_GRAYSCALE);        
-        grayThumbnail.allocate(width, height, OF_IMAGE_GRAYSCALE);        
-    }
-    
-    cam.setup(width, height, camFramerate, videoColor); // color/gray;
+    // * frame source *
+    // picam, or replayed footage: video, images (a directory) or raw (a frame dump)
+    sourceType = settings.getValue("settings:source", "picam");
+    string sourcePath = settings.getValue("settings:source_path", "");
+    int sourceFramerate = settings.getValue("settings:source_framerate", camFramerate); // 0 for as fast as possible
+    bool sourceLoop = (bool) settings.getValue("settings:source_loop", 1);
+    bool sourceLossless = (bool) settings.getValue("settings:source_lossless", 0); // replay every frame, never overwrite one
 
     camRotation = settings.getValue("settings:cam_rotation", 0); 
     camSharpness = settings.getValue("settings:sharpness", 0); 
@@ -71,15 +77,31 @@ void ofApp::setup() {
     camExposureCompensation = settings.getValue("settings:exposure_compensation", 0); 
     camShutterSpeed = settings.getValue("settings:shutter_speed", 0);
 
-    cam.setRotation(camRotation);
-    cam.setSharpness(camSharpness);
-    cam.setContrast(camContrast);
-    cam.setBrightness(camBrightness);
-    cam.setISO(camIso);
-    cam.setExposureMode((MMAL_PARAM_EXPOSUREMODE_T) camExposureMode);
-    cam.setExposureCompensation(camExposureCompensation);
-    cam.setShutterSpeed(camShutterSpeed);
-    //cam.setFrameRate // not implemented in ofxCvPiCam 
+    if (sourceType == "video") {
+        source.reset(new VideoFileSource(sourcePath));
+    } else if (sourceType == "images") {
+        source.reset(new ImageSequenceSource(sourcePath, sourceFramerate > 0 ? sourceFramerate : camFramerate));
+    } else if (sourceType == "raw") {
+        source.reset(new RawDumpSource(sourcePath));
+    } else {
+        PiCamSource::Settings camSettings;
+        camSettings.framerate = camFramerate;
+        camSettings.rotation = camRotation;
+        camSettings.sharpness = camSharpness;
+        camSettings.contrast = camContrast;
+        camSettings.brightness = camBrightness;
+        camSettings.iso = camIso;
+        camSettings.exposureMode = camExposureMode;
+        camSettings.exposureCompensation = camExposureCompensation;
+        camSettings.shutterSpeed = camShutterSpeed;
+        source.reset(new PiCamSource(camSettings));
+        sourceFramerate = camFramerate;
+        sourceLossless = false; // a camera can't wait
+    }
+    source->setLoop(sourceLoop);
+    if (!source->setup(width, height, videoColor)) {
+        ofLogError("ofApp::setup") << "frame source " << source->getName() << " failed, no frames will arrive";
+    }
 
     // ~ ~ ~   get a persistent name for this computer   ~ ~ ~
     // a randomly generated id
@@ -89,8 +111,6 @@ void ofApp::setup() {
     ofSystem("cp /etc/hostname " + ofToDataPath("DocumentRoot/js/"));
     hostName = getHostName();
     
-    fbo.allocate(width, height, GL_RGBA);
-    pixels.allocate(width, height, OF_IMAGE_COLOR);
         
     thresholdValue = settings.getValue("settings:threshold", 127); 
     contourThreshold = 2.0;
@@ -98,186 +118,413 @@ void ofApp::setup() {
     contourMaxAreaRadius = 250.0;   
     simplify = settings.getValue("settings:simplify", 0.5);
     smooth = settings.getValue("settings:smooth", 2);
-    contourFinder.setMinAreaRadius(contourMinAreaRadius);
-    contourFinder.setMaxAreaRadius(contourMaxAreaRadius);
     //contourFinder.setInvert(true); // find black instead of white
     trackingColorMode = TRACK_COLOR_RGB;
 
     // * stream video *
-    int maxClientConnections = settings.getValue("settings:max_stream_connections", 5); // default 5
-    int maxClientBitRate = settings.getValue("settings:max_stream_bitrate", 512); // default 1024
-    int maxClientFrameRate = settings.getValue("settings:max_stream_framerate", 30); // default 30
-    int maxClientQueueSize = settings.getValue("settings:max_stream_queue", 10); // default 10
-    if (sendMjpeg) setupMjpeg(streamServer, streamPort, maxClientConnections, maxClientBitRate, maxClientFrameRate, maxClientQueueSize, width, height, "live_view.html");
+    // every jpeg of a frame is encoded once and shared by mjpeg, sync video and photos
+    jpegCache.setup(8);
+    streamQuality = settings.getValue("settings:stream_quality", 50); // 0 to 100, default 50
+    // each client steps down this quality ladder, then halves its frame rate, when it falls behind
+    vector<int> streamQualities { streamQuality, streamQuality * 2 / 3, streamQuality / 3 };
+    MjpegServer::Settings mjpegSettings;
+    mjpegSettings.port = streamPort;
+    mjpegSettings.maxConnections = settings.getValue("settings:max_stream_connections", 5); // default 5
+    mjpegSettings.maxKbps = settings.getValue("settings:max_stream_bitrate", 512); // per client, default 512, 0 for no limit
+    mjpegSettings.maxFramerate = settings.getValue("settings:max_stream_framerate", 30); // default 30
+    mjpegSettings.maxQueue = settings.getValue("settings:max_stream_queue", 1); // per client, default 1
+    mjpegSettings.qualities = streamQualities;
+    mjpegSettings.indexFile = ofToDataPath("DocumentRoot/live_view.html", true);
+    mjpegServer.setup(mjpegSettings, jpegCache);
+    mjpegServer.onClientStats = [this](vector<ClientStats>& stats) { wsClients.getClientStats(stats); };
+    mjpegServer.onRoute = [this](const string& path, string& body, string& contentType) { return routeMetrics(path, body, contentType); };
+
+    // * metrics *
+    statsInterval = settings.getValue("settings:stats_interval", 1.0); // seconds, 0 for off
+    lastStatsTime = 0;
+
+    // without the post server the stream port is the only place to scrape /metrics
+    if (sendMjpeg || (statsInterval > 0 && !sendHttp)) mjpegServer.start();
 
     // * post form *
-    if (sendHttp) setupHttp(this, postServer, postPort, "result.html");
+    if (sendHttp) {
+        setupHttp(this, postServer, postPort, "result.html");
+        // routes added later are asked first, so this goes ahead of the DocumentRoot files
+        metricsRoute.onRoute = [this](const string& path, string& body, string& contentType) { return routeMetrics(path, body, contentType); };
+        postServer.addRoute(&metricsRoute);
+    }
 
     // * websockets *
     // events: connect, open, close, idle, message, broadcast
     if (sendWs) setupWsServer(this, wsServer, wsPort);
+    vector<int> videoQualities;
+    for (int level = syncVideoQuality; level >= max(syncVideoQuality - 2, 1); level--) videoQualities.push_back(JpegCache::qualityFromLevel(level));
+    wsClients.setup(mjpegSettings.maxQueue, camFramerate, mjpegSettings.maxKbps, videoQualities);
 
     if (sendOsc) setupOscSender(sender, oscHost, oscPort);
+
+    // * batched output *
+    // one message per frame per analysis instead of one per blob / contour
+    batchOutput = (bool) settings.getValue("settings:batch_output", 0);
+    int maxPacketSize = settings.getValue("settings:osc_max_packet", 1400); // stay under the network's MTU
+    bool compactWireFormat = settings.getValue("settings:wire_format", "float") == "compact"; // see WireFormat.h
+    batchSender.setup(sendOsc ? &sender : nullptr, sendWs ? &wsClients : nullptr, hostName, sessionId, maxPacketSize, compactWireFormat);
+
+    // * capture thread *
+    grabber.setup(*source, width, height, sourceFramerate, videoColor, []() { return getTimestamp(); }, sourceLossless);
+
+    // * vision pipeline *
+    VisionPipeline::Settings pipelineSettings;
+    pipelineSettings.blobs = blobs;
+    pipelineSettings.contours = contours;
+    pipelineSettings.brightestPixel = brightestPixel;
+    pipelineSettings.syncVideo = syncVideo;
+    pipelineSettings.packContours = !batchOutput;
+    pipelineSettings.lossless = sourceLossless;
+    pipelineSettings.thresholdValue = thresholdValue;
+    pipelineSettings.contourThreshold = contourThreshold;
+    pipelineSettings.contourMinAreaRadius = contourMinAreaRadius;
+    pipelineSettings.contourMaxAreaRadius = contourMaxAreaRadius;
+    pipelineSettings.contourSlices = contourSlices;
+    pipelineSettings.simplify = simplify;
+    pipelineSettings.smooth = smooth;
+    pipelineSettings.contourThreads = contourThreads;
+    pipelineSettings.peaks = brightestPixelPeaks;
+    pipelineSettings.peakDistance = peakDistance;
+    pipelineSettings.blobTracking = blobTracking;
+    pipelineSettings.trackingRoiMargin = settings.getValue("settings:tracking_roi_margin", 20); // pixels, default 20
+    pipelineSettings.trackingFullScanInterval = settings.getValue("settings:tracking_full_scan_interval", 30); // frames, default 30
+    pipelineSettings.trackingPersistence = settings.getValue("settings:tracking_persistence", 15); // frames, default 15
+    pipelineSettings.trackingMaxDistance = settings.getValue("settings:tracking_max_distance", 64); // pixels, default 64
+    pipelineSettings.changeDetection = changeDetection;
+    pipelineSettings.changeThreshold = settings.getValue("settings:change_threshold", 8); // gray levels, default 8
+    pipelineSettings.changeNearThreshold = settings.getValue("settings:change_near_threshold", 4); // gray levels near a previous result, default 4
+    pipelineSettings.changeDownsample = settings.getValue("settings:change_downsample", 4); // default 4
+    pipelineSettings.changeTileSize = settings.getValue("settings:change_tile_size", 8); // downsampled pixels, default 8
+    pipelineSettings.changeMinTiles = settings.getValue("settings:change_min_tiles", 1); // default 1
+    pipelineSettings.changeKeepAlive = settings.getValue("settings:change_keep_alive", 1.0); // seconds, default 1
+    pipelineSettings.blobsRate = settings.getValue("settings:blobs_rate", 0.0); // per second, default 0 for every frame
+    pipelineSettings.contoursRate = settings.getValue("settings:contours_rate", 0.0);
+    pipelineSettings.brightestPixelRate = settings.getValue("settings:brightest_pixel_rate", 0.0);
+    pipelineSettings.syncVideoRate = settings.getValue("settings:sync_video_rate", 0.0);
+    pipelineSettings.blobsPriority = settings.getValue("settings:blobs_priority", 3); // higher is shed later, default 3
+    pipelineSettings.contoursPriority = settings.getValue("settings:contours_priority", 0); // default 0
+    pipelineSettings.brightestPixelPriority = settings.getValue("settings:brightest_pixel_priority", 2); // default 2
+    pipelineSettings.syncVideoPriority = settings.getValue("settings:sync_video_priority", 1); // default 1
+    pipelineSettings.loadShedding = loadShedding;
+    float frameBudget = settings.getValue("settings:frame_budget", 0.0); // ms, default 0 for one camera frame
+    pipelineSettings.frameBudget = frameBudget > 0 ? frameBudget : 1000.0f / max(camFramerate, 1);
+    pipelineSettings.videoQualitySteps = syncVideoQuality - 1;
+    pipelineSettings.roi.x = settings.getValue("settings:roi_x", 0); // full-frame pixels
+    pipelineSettings.roi.y = settings.getValue("settings:roi_y", 0);
+    pipelineSettings.roi.width = settings.getValue("settings:roi_width", 0); // default 0 for the whole frame
+    pipelineSettings.roi.height = settings.getValue("settings:roi_height", 0);
+    string maskFile = settings.getValue("settings:mask", ""); // image in data, black where nothing should be found
+    if (!maskFile.empty()) {
+        ofPixels maskPixels;
+        if (ofLoadImage(maskPixels, maskFile)) {
+            maskPixels.setImageType(OF_IMAGE_GRAYSCALE);
+            maskPixels.resize(width, height);
+            toCv(maskPixels).copyTo(pipelineSettings.mask);
+        } else {
+            ofLogError("ofApp::setup") << "can't load mask " << maskFile;
+        }
+    }
+    pipelineSettings.blobsLevel = settings.getValue("settings:blobs_level", 0); // halvings, default 0 for full resolution
+    pipelineSettings.contoursLevel = settings.getValue("settings:contours_level", 0);
+    pipelineSettings.brightestPixelLevel = settings.getValue("settings:brightest_pixel_level", 0);
+    pipeline.setup(grabber, pipelineSettings);
+
+    pipeline.onSerialize = [this](FrameJob& job) {
+        // under load the scheduler may ask for a cheaper thumbnail
+        int level = max(syncVideoQuality - job.plan.videoQualityDrop, 1);
+        job.video = jpegCache.get(job.seq, job.pixels, thumbWidth, thumbHeight, JpegCache::qualityFromLevel(level));
+        job.hasVideo = true;
+    };
+    pipeline.onSend = [this](FrameJob& job) {
+        sendResult(job);
+    };
+
+    // * photos *
+    int maxPhotoQueue = settings.getValue("settings:max_photo_queue", 4);
+    photoQueue.setup(ofToDataPath("DocumentRoot/photos", true), hostName, maxPhotoQueue, jpegCache, stillCompression);
+    photoQueue.onSaved = [this](PhotoQueue::Photo& photo) { onPhotoSaved(photo); };
+    photoQueue.onEncoded = [this](PhotoQueue::Photo& photo) { onPhotoEncoded(photo); };
+
+    // * pre-roll *
+    preRoll = (bool) settings.getValue("settings:preroll", 0);
+    burstFormat = PreRollBuffer::formatFromString(settings.getValue("settings:burst_format", "images"));
+    if (preRoll) {
+        PreRollBuffer::Settings preRollSettings;
+        preRollSettings.path = settings.getValue("settings:preroll_path", "preroll.pfd");
+        preRollSettings.preSeconds = settings.getValue("settings:preroll_seconds", 5.0); // default 5
+        preRollSettings.postSeconds = settings.getValue("settings:postroll_seconds", 2.0); // default 2
+        preRollSettings.framerate = camFramerate;
+        preRollSettings.quality = stillCompression;
+        preRollSettings.outputDirectory = ofToDataPath("DocumentRoot/bursts", true);
+        preRollSettings.prefix = hostName;
+        preRoll = preRollBuffer.setup(width, height, videoColor ? 3 : 1, preRollSettings, jpegCache);
+        preRollBuffer.onDumped = [this](const string& path, int numFrames) { onBurstDumped(path, numFrames); };
+    }
+
+    // every frame, before change detection or drops; both only take a reference to the buffer
+    pipeline.onFrame = [this](const Frame& frame) {
+        if (sendMjpeg) mjpegServer.post(frame.seq, frame.buffer);
+        if (preRoll) preRollBuffer.add(frame.buffer, frame.seq, frame.timestamp, frame.grabMicros);
+    };
+
+    grabber.start();
+    pipeline.start();
+    photoQueue.start();
+    if (preRoll) preRollBuffer.start();
+
+    Metrics::get().set(Metrics::STARTUP_MS, millisSinceLaunch());
+    ofLogNotice("ofApp::setup") << (headless ? "headless, " : "") << "started in " << millisSinceLaunch() << "ms";
+}
+
+int64_t ofApp::millisSinceLaunch() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - launchTime).count();
 }
 
 //--------------------------------------------------------------
 void ofApp::update() {
-    timestamp = getTimestamp();
-    
-    frame = cam.grab();
+    // headless there is nothing to draw, so wait for the next frame instead of polling
+    bool arrived = headless ? pipeline.waitForResult(result, 100) : pipeline.getLatestResult(result);
+    if (arrived) {
+        timestamp = result->timestamp;
+        if (firstFrame) {
+            Metrics::get().set(Metrics::FIRST_FRAME_MS, millisSinceLaunch());
+            firstFrame = false;
+        }
+    }
 
-    if (!frame.empty()) {
-        toOf(frame, gray.getPixelsRef());
+    if (statsInterval > 0 && ofGetElapsedTimef() - lastStatsTime >= statsInterval) {
+        lastStatsTime = ofGetElapsedTimef();
+        publishStats();
+    }
+}
 
-        if (sendMjpeg) streamServer.send(gray.getPixels());
-        
-        if (syncVideo) {
-	    grayThumbnail.setFromPixels(gray.getPixels());
-	    grayThumbnail.resize(thumbWidth, thumbHeight);
-            imageToBuffer(grayThumbnail, videoBuffer, syncVideoQuality);
-       	}
+//--------------------------------------------------------------
+// /metrics and /metrics.json, on the post server and the stream port; any thread
+bool ofApp::routeMetrics(const string& path, string& body, string& contentType) {
+    Metrics::Snapshot snapshot;
+    if (path == "/metrics") {
+        Metrics::get().snapshot(snapshot);
+        body = Metrics::toPrometheus(snapshot, hostName);
+        contentType = "text/plain; version=0.0.4";
+        return true;
+    } else if (path == "/metrics.json") {
+        Metrics::get().snapshot(snapshot);
+        body = Metrics::toJson(snapshot, hostName, sessionId);
+        contentType = "application/json";
+        return true;
+    }
+    return false;
+}
+
+// headline numbers as /stats over OSC; the full set is served live on /metrics
+// and /metrics.json of the post server (and of the stream port, when it's on)
+void ofApp::publishStats() {
+    Metrics::Snapshot snapshot;
+    Metrics::get().snapshot(snapshot);
+
+    if (sendOsc) {
+        ofxOscMessage m;
+        m.setAddress("/stats");
+        m.addStringArg(hostName);
+        m.addStringArg(sessionId);
+        m.addInt64Arg(snapshot.counters[Metrics::FRAMES_GRABBED]);
+        m.addInt64Arg(snapshot.counters[Metrics::FRAMES_PROCESSED]);
+        m.addInt64Arg(snapshot.counters[Metrics::DROPPED_GRABBER] + snapshot.counters[Metrics::DROPPED_PIPELINE]);
+        m.addFloatArg(snapshot.percentile(Metrics::FRAME, 0.5) / 1000.0);
+        m.addFloatArg(snapshot.percentile(Metrics::FRAME, 0.99) / 1000.0);
+        sender.sendMessage(m, false);
     }
 }
 
 //--------------------------------------------------------------
 void ofApp::draw() {
+    if (headless) return;
     ofBackground(0);
 
-    if(!frame.empty()) {
-        if (debug) {
-            if (!blobs && !contours) {
-                drawMat(frame, 0, 0);
-            } else if (blobs || contours) {
-                drawMat(frameProcessed, 0, 0);
+    if (result && debug) {
+        // upload each result once, into a texture that is only reallocated if the size changes
+        if (result->seq != drawnSeq) {
+            // blobs found in a region or at a lower level have a smaller thresholded image
+            const cv::Mat& view = result->hasBlobs && result->processed.size() == result->frame.size() ? result->processed : result->frame;
+            int glFormat = view.channels() == 1 ? GL_LUMINANCE : GL_RGB;
+            if (frameTexture.getWidth() != view.cols || frameTexture.getHeight() != view.rows || frameTexture.getTextureData().glInternalFormat != glFormat) {
+                frameTexture.allocate(view.cols, view.rows, glFormat);
             }
+            frameTexture.loadData(view.ptr<unsigned char>(), view.cols, view.rows, glFormat);
+            drawnSeq = result->seq;
         }
+        frameTexture.draw(0, 0);
 
-        if (syncVideo) {
-            if (sendOsc) sendOscVideo(sender, hostName, sessionId, videoBuffer, timestamp);
-            if (sendWs) sendWsVideo(wsServer, hostName, sessionId, videoBuffer, timestamp);
-        } 
+        ofSetLineWidth(2);
+        ofNoFill();
 
-        if (blobs) {
-            if (debug) {
-            	ofSetLineWidth(2);
-            	ofNoFill();
-            }
-            
-            //autothreshold(frameProcessed);        
-            threshold(frame, frameProcessed, thresholdValue, 255, 0);
-            contourFinder.setThreshold(contourThreshold);    
-            contourFinder.findContours(frameProcessed);
-
-            int n = contourFinder.size();
-            for (int i = 0; i < n; i++) {
-                float circleRadius;
-                glm::vec2 circleCenter = toOf(contourFinder.getMinEnclosingCircle(i, circleRadius));
-                if (debug) {
-                	ofSetColor(cyanPrint);
-                	ofDrawCircle(circleCenter, circleRadius);
-                	ofDrawCircle(circleCenter, 1);
-                }
-
-                if (sendOsc) sendOscBlobs(sender, hostName, sessionId, i, circleCenter.x, circleCenter.y, timestamp);
-                if (sendWs) sendWsBlobs(wsServer, hostName, sessionId, i, circleCenter.x, circleCenter.y, timestamp);
+        if (result->hasBlobs) {
+            ofSetColor(cyanPrint);
+            for (auto& blob : result->blobs) {
+                ofDrawCircle(blob.center, blob.radius);
+                ofDrawCircle(blob.center, 1);
             }
         }
 
-        if (contours) {
-            if (debug) {
-                ofSetLineWidth(2);
-                ofNoFill();
-            }
-
-            int contourCounter = 0;
-            unsigned char * pixels = gray.getPixels().getData();
-            int gw = gray.getWidth();
-
-            for (int h=0; h<255; h += int(255/contourSlices)) {
-                contourFinder.setThreshold(h);
-                contourFinder.findContours(frame);
-                if (debug) contourFinder.draw();            
-
-                int n = contourFinder.size();
-                for (int i = 0; i < n; i++) {
-                    ofPolyline line = contourFinder.getPolyline(i);
-                    line.simplify(simplify);
-                    line = line.getSmoothed(smooth, 0.5);
-                    vector<glm::vec3> cvPoints = line.getVertices();
-
-                    int x = int(cvPoints[0].x);
-                    int y = int(cvPoints[0].y);
-                    ofColor col = pixels[x + y * gw];
-                    float colorData[3]; 
-                    colorData[0] = col.r;
-                    colorData[1] = col.g;
-                    colorData[2] = col.b;
-                    char const * pColor = reinterpret_cast<char const *>(colorData);
-                    std::string colorString(pColor, pColor + sizeof colorData);
-                    contourColorBuffer.set(colorString); 
-
-                    float z = col.getBrightness();
-                    float pointsData[cvPoints.size() * 3]; 
-                    for (int j=0; j<cvPoints.size(); j++) {
-                        int index = j * 3;
-                        pointsData[index] = cvPoints[j].x;
-                        pointsData[index+1] = cvPoints[j].y;
-                        pointsData[index+2] = z; ///cvPoints[j].z;
-                    }
-                    char const * pPoints = reinterpret_cast<char const *>(pointsData);
-                    std::string pointsString(pPoints, pPoints + sizeof pointsData);
-                    contourPointsBuffer.set(pointsString); 
-
-                    if (sendOsc) sendOscContours(sender, hostName, sessionId, contourCounter, contourColorBuffer, contourPointsBuffer, timestamp);
-                    if (sendWs) sendWsContours(wsServer, hostName, sessionId, contourCounter, contourColorBuffer, contourPointsBuffer, timestamp);
-                    contourCounter++;
-                }        
+        if (result->hasContours) {
+            for (int i = 0; i < result->numContours; i++) {
+                const ContourResult& contour = result->contours[i];
+                ofSetColor(contour.color);
+                ofPolyline(contour.points).draw();
             }
         }
-           
-        if (brightestPixel) {
-        	// this mostly useful as a performance baseline
-            // https://openframeworks.cc/ofBook/chapters/image_processing_computer_vision.html
-            float maxBrightness = 0; 
-            float maxBrightnessX = 0; 
-            float maxBrightnessY = 0;
-            int skip = 2;
-
-            for (int y=0; y<height - skip; y += skip) {
-                for (int x=0; x<width - skip; x += skip) {
-                    ofColor colorAtXY = gray.getColor(x, y);
-                    float brightnessOfColorAtXY = colorAtXY.getBrightness();
-                    if (brightnessOfColorAtXY > maxBrightness && brightnessOfColorAtXY > thresholdValue) {
-                        maxBrightness = brightnessOfColorAtXY;
-                        maxBrightnessX = x;
-                        maxBrightnessY = y;
-                    }
-                }
-            }
 
-            if (debug) {
-            	ofNoFill();
-            	glm::vec2 circleCenter = glm::vec2(maxBrightnessX, maxBrightnessY);
-            	ofDrawCircle(circleCenter, 40);
+        if (result->hasPixel) {
+            ofSetColor(255);
+            ofDrawCircle(glm::vec2(result->pixel.x, result->pixel.y), 40);
+            for (auto& peak : result->peaks) {
+                ofDrawCircle(glm::vec2(peak.cx, peak.cy), 10);
             }
-
-            if (sendOsc) sendOscPixel(sender, hostName, sessionId, maxBrightnessX, maxBrightnessY, timestamp);
-            if (sendWs) sendWsPixel(wsServer, hostName, sessionId, maxBrightnessX, maxBrightnessY, timestamp);
         }
+        ofSetColor(255);
     }
 
     if (debug) {
         stringstream info;
-        info << cam.width << "x" << cam.height << " @ "<< ofGetFrameRate() <<"fps"<< "\n";
+        info << width << "x" << height << " @ "<< ofGetFrameRate() <<"fps"<< " from " << sourceType << "\n";
+        info << "dropped " << grabber.getFramesDropped() << " / " << grabber.getFramesGrabbed() << "\n";
+        info << "processed " << pipeline.getFramesProcessed() << ", skipped " << pipeline.getFramesDropped() << "\n";
+        if (changeDetection) {
+            uint64_t unchanged = pipeline.getFramesUnchanged();
+            uint64_t considered = unchanged + pipeline.getFramesProcessed();
+            info << "unchanged " << unchanged << " (" << (considered > 0 ? int(100 * unchanged / considered) : 0) << "%)\n";
+        }
+        if (loadShedding) {
+            const FrameScheduler& scheduler = pipeline.getScheduler();
+            info << "shed level " << scheduler.getShedLevel() << "/" << scheduler.getNumShedLevels() << ", frame " << int(scheduler.getAverageFrameMillis()) << "ms\n";
+        }
+        if (contours) {
+            const ContourSlicer& slicer = pipeline.getContourSlicer();
+            float total = 0;
+            for (int i = 0; i < slicer.getNumSlices(); i++) total += slicer.getAverageSliceMicros(i);
+            info << slicer.getNumSlices() << " slices, " << int(total) << "us total\n";
+        }
+        if (photoQueue.getLastLatencyMillis() > 0) {
+            info << "photo " << int(photoQueue.getLastLatencyMillis()) << "ms, avg " << int(photoQueue.getAverageLatencyMillis()) << "ms, max " << int(photoQueue.getMaxLatencyMillis()) << "ms\n";
+        }
+        vector<ClientStats> clientStats;
+        mjpegServer.getClientStats(clientStats);
+        wsClients.getClientStats(clientStats);
+        for (auto& client : clientStats) {
+            info << client.transport << " " << client.address << " " << int(client.fps) << "/" << client.framerate << "fps q" << client.quality;
+            info << " queued " << client.queuedFrames << " dropped " << client.droppedFrames << " " << int(client.latencyMillis) << "ms\n";
+        }
         ofDrawBitmapStringHighlight(info.str(), 10, 10, ofColor::black, ofColor::yellow);
     }
 }
 
+//--------------------------------------------------------------
+// called on the pipeline's send thread
+void ofApp::sendResult(FrameJob& job) {
+    Metrics& metrics = Metrics::get();
+
+    if (job.hasVideo) {
+        // the Pinopticon helpers take a non-const buffer but only read it
+        ofBuffer& videoBuffer = const_cast<ofBuffer&>(*job.video);
+        if (sendOsc) {
+            ScopedMetric metric(Metrics::SEND_OSC);
+            sendOscVideo(sender, hostName, sessionId, videoBuffer, job.timestamp);
+            metrics.add(Metrics::MESSAGES_OSC);
+            metrics.add(Metrics::BYTES_OSC, videoBuffer.size());
+        }
+        // batched clients get paced binary video, the legacy message format goes to everyone
+        // through the helpers; wsClients counts WebSocket frames as they're sent, either way
+        if (sendWs && batchOutput) sendWsVideoPaced(job);
+        else if (sendWs) sendWsVideo(wsServer, hostName, sessionId, videoBuffer, job.timestamp);
+    }
+
+    if (batchOutput) {
+        if (job.hasBlobs) batchSender.sendBlobs(job);
+        if (job.hasContours) batchSender.sendContours(job);
+        if (job.hasPixel) batchSender.sendPixels(job);
+        return;
+    }
+
+    // the per-item messages; sizes are only counted where we hold the payload
+    if (sendOsc) {
+        ScopedMetric metric(Metrics::SEND_OSC);
+        if (job.hasBlobs) {
+            for (auto& blob : job.blobs) {
+                sendOscBlobs(sender, hostName, sessionId, blob.index, blob.center.x, blob.center.y, job.timestamp);
+            }
+            metrics.add(Metrics::MESSAGES_OSC, job.blobs.size());
+        }
+        if (job.hasContours) {
+            for (int i = 0; i < job.numContours; i++) {
+                ContourResult& contour = job.contours[i];
+                sendOscContours(sender, hostName, sessionId, i, contour.colorBuffer, contour.pointsBuffer, job.timestamp);
+                metrics.add(Metrics::BYTES_OSC, contour.colorBuffer.size() + contour.pointsBuffer.size());
+            }
+            metrics.add(Metrics::MESSAGES_OSC, job.numContours);
+        }
+        if (job.hasPixel) {
+            sendOscPixel(sender, hostName, sessionId, job.pixel.x, job.pixel.y, job.timestamp);
+            metrics.add(Metrics::MESSAGES_OSC);
+        }
+    }
+
+    // the helpers own the per-item format and broadcast it themselves, see WsClients.h
+    if (sendWs) {
+        if (job.hasBlobs) {
+            for (auto& blob : job.blobs) {
+                sendWsBlobs(wsServer, hostName, sessionId, blob.index, blob.center.x, blob.center.y, job.timestamp);
+            }
+        }
+        if (job.hasContours) {
+            for (int i = 0; i < job.numContours; i++) {
+                ContourResult& contour = job.contours[i];
+                sendWsContours(wsServer, hostName, sessionId, i, contour.colorBuffer, contour.pointsBuffer, job.timestamp);
+            }
+        }
+        if (job.hasPixel) sendWsPixel(wsServer, hostName, sessionId, job.pixel.x, job.pixel.y, job.timestamp);
+    }
+}
+
+// a text frame describing the thumbnail, then the jpeg as a binary frame, at each client's quality
+void ofApp::sendWsVideoPaced(FrameJob& job) {
+    if (wsClients.getNumClients() == 0) return;
+
+    wsClients.broadcastVideo([&](int quality) {
+        JpegCache::Jpeg jpeg = jpegCache.get(job.seq, job.pixels, thumbWidth, thumbHeight, quality);
+        string msg = "{\"unique_id\":\"" + sessionId + "\",\"hostname\":\"" + hostName + "\",\"type\":\"video\",\"seq\":" + ofToString(job.seq) + ",\"video_bytes\":" + ofToString(jpeg->size()) + ",\"timestamp\":\"" + ofToString(job.timestamp) + "\"}";
+        shared_ptr<WsClients::Message> message = make_shared<WsClients::Message>();
+        message->push_back(ofxHTTP::WebSocketFrame(msg));
+        message->push_back(ofxHTTP::WebSocketFrame(*jpeg, Poco::Net::WebSocket::FRAME_BINARY));
+        return shared_ptr<const WsClients::Message>(message);
+    });
+}
+
+//--------------------------------------------------------------
+void ofApp::exit() {
+    preRollBuffer.stop();
+    photoQueue.stop();
+    pipeline.stop();
+    mjpegServer.stop();
+    grabber.stop();
+    source->close();
+}
+
 // ~ ~ ~ POST ~ ~ ~
 void ofApp::onHTTPPostEvent(ofxHTTP::PostEventArgs& args) {
-    ofLogNotice("ofApp::onHTTPPostEvent") << "Data: " << args.getBuffer().getText();
+    string data = args.getBuffer().getText();
+    ofLogNotice("ofApp::onHTTPPostEvent") << "Data: " << data;
 
-    takePhoto();
+    if (ofIsStringInString(data, "dump_burst")) {
+        dumpBurst(ofIsStringInString(data, "mjpeg") ? PreRollBuffer::MJPEG : burstFormat);
+    } else {
+        takePhoto();
+    }
 }
 
 
@@ -285,7 +532,12 @@ void ofApp::onHTTPFormEvent(ofxHTTP::PostFormEventArgs& args) {
     ofLogNotice("ofApp::onHTTPFormEvent") << "";
     ofxHTTP::HTTPUtils::dumpNameValueCollection(args.getForm(), ofGetLogLevel());
     
-    takePhoto();
+    if (args.getForm().has("dump_burst")) {
+        string format = args.getForm().get("dump_burst");
+        dumpBurst(format.empty() ? burstFormat : PreRollBuffer::formatFromString(format));
+    } else {
+        takePhoto();
+    }
 }
 
 
@@ -315,40 +567,43 @@ void ofApp::onHTTPUploadEvent(ofxHTTP::PostUploadEventArgs& args) {
 
 // ~ ~ ~ WEBSOCKETS ~ ~ ~
 void ofApp::onWebSocketOpenEvent(ofxHTTP::WebSocketEventArgs& evt) {
-    cout << "Websocket connection opened." << evt.connection().clientAddress().toString() << endl;
+    ofLogNotice("ofApp::onWebSocketOpenEvent") << evt.connection().clientAddress().toString();
+    wsClients.onOpen(evt.connection());
 }
 
 void ofApp::onWebSocketCloseEvent(ofxHTTP::WebSocketCloseEventArgs& evt) {
-    cout << "Websocket connection closed." << evt.connection().clientAddress().toString() << endl;
+    ofLogNotice("ofApp::onWebSocketCloseEvent") << evt.connection().clientAddress().toString();
+    wsClients.onClose(evt.connection());
 }
 
 void ofApp::onWebSocketFrameReceivedEvent(ofxHTTP::WebSocketFrameEventArgs& evt) {
-    cout << "Websocket frame was received:" << evt.connection().clientAddress().toString() << endl;
     string msg = evt.frame().getText();
-    cout <<  msg << endl;
+    ofLogVerbose("ofApp::onWebSocketFrameReceivedEvent") << evt.connection().clientAddress().toString() << ": " << msg;
 
     if (msg == "take_photo") {
         takePhoto();
     } else if (msg == "stream_photo") {
         streamPhoto();
+    } else if (msg == "dump_burst") {
+        dumpBurst(burstFormat);
+    } else if (ofIsStringInString(msg, "dump_burst ")) { // dump_burst images|mjpeg
+        dumpBurst(PreRollBuffer::formatFromString(msg.substr(msg.find(' ') + 1)));
     }
 }
 
 void ofApp::onWebSocketFrameSentEvent(ofxHTTP::WebSocketFrameEventArgs& evt) {
-    cout << "Websocket frame was sent." << endl;
+    wsClients.onFrameSent(evt.connection(), evt.frame());
 }
 
 
 void ofApp::onWebSocketErrorEvent(ofxHTTP::WebSocketErrorEventArgs& evt) {
-    cout << "Websocket Error." << evt.connection().clientAddress().toString() << endl;
+    ofLogWarning("ofApp::onWebSocketErrorEvent") << evt.connection().clientAddress().toString();
+    wsClients.onClose(evt.connection());
 }
 
 // ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ ~
 void ofApp::createResultHtml(string fileName) {
-    string photoIndexFileName = "DocumentRoot/result.html";
-    ofBuffer buff;
-    ofFile photoIndexFile;
-    photoIndexFile.open(ofToDataPath(photoIndexFileName), ofFile::ReadWrite, false);
+    string photoIndexFileName = ofToDataPath("DocumentRoot/result.html", true);
 
     string photoIndex = "<!DOCTYPE html>\n";
     
@@ -358,40 +613,67 @@ void ofApp::createResultHtml(string fileName) {
     } else { // otherwise make a new one
         photoIndex += "<html><head></head><body>\n";
         
-        string lastFile = ofFilePath::getFileName(fileName);
-
-        //lastPhotoTakenName = ofFilePath::getFileName(fileName);
-        lastPhotoTakenName = hostName + "_" + lastFile;
-        ofSystem("mv " + ofToDataPath("DocumentRoot/photos/" + lastFile) + " " + ofToDataPath("DocumentRoot/photos/" + lastPhotoTakenName));
+        lastPhotoTakenName = ofFilePath::getFileName(fileName);
         
         photoIndex += "<a href=\"photos/" + lastPhotoTakenName + "\">" + lastPhotoTakenName + "</a>\n";
     }
 
     photoIndex += "</body></html>\n";
 
-    buff.set(photoIndex.c_str(), photoIndex.size());
-    ofBufferToFile(photoIndexFileName, buff);
+    // swap the whole file in so the web server never serves half a page
+    ofBuffer buff(photoIndex.c_str(), photoIndex.size());
+    string tempFileName = photoIndexFileName + ".tmp";
+    if (ofBufferToFile(tempFileName, buff)) std::rename(tempFileName.c_str(), photoIndexFileName.c_str());
 }
 
+// called from the HTTP / WebSocket event threads, the work happens on photoQueue's worker
 void ofApp::takePhoto() {
-    ofSaveImage(gray, photoBuffer, OF_IMAGE_FORMAT_JPEG, OF_IMAGE_QUALITY_BEST);
-    string fileName = "photo_" + ofToString(timestamp) + ".jpg";
-    ofBufferToFile(ofToDataPath("DocumentRoot/photos/") + fileName, photoBuffer);
-    createResultHtml(fileName);
+    shared_ptr<const FrameJob> latest;
+    if (!pipeline.getLatestResult(latest)) return;
 
-    //string msg = "{\"unique_id\":" + sessionId + ",\"hostname\":" + hostName + ",\"photo\":" + ofxCrypto::base64_encode(photoBuffer) + ",\"timestamp\":" + ofToString(timestamp) + "}";
-    string msg = hostName + "," + lastPhotoTakenName;
-    wsServer.webSocketRoute().broadcast(ofxHTTP::WebSocketFrame(msg));
+    if (photoQueue.request(PhotoQueue::SAVE, latest->pixels, latest->timestamp, latest->seq) == PhotoQueue::REJECTED) {
+        ofLogWarning("ofApp::takePhoto") << "photo queue full, request dropped";
+    }
 }
 
 void ofApp::streamPhoto() {
-    ofSaveImage(gray, photoBuffer, OF_IMAGE_FORMAT_JPEG, OF_IMAGE_QUALITY_BEST);
-    //string fileName = "photo_" + ofToString(timestamp) + ".jpg";
-    //ofBufferToFile(ofToDataPath("DocumentRoot/photos/") + fileName, photoBuffer);
-    //createResultHtml(fileName);
-
-    string photo64 = ofxCrypto::base64_encode(photoBuffer);
-    string msg = "{\"unique_id\":\"" + sessionId + "\",\"hostname\":\"" + hostName + "\",\"photo\":\"" + photo64 + "\",\"timestamp\":\"" + ofToString(timestamp) + "\"}";
-    wsServer.webSocketRoute().broadcast(ofxHTTP::WebSocketFrame(msg));
+    shared_ptr<const FrameJob> latest;
+    if (!pipeline.getLatestResult(latest)) return;
+
+    if (photoQueue.request(PhotoQueue::STREAM, latest->pixels, latest->timestamp, latest->seq) == PhotoQueue::REJECTED) {
+        ofLogWarning("ofApp::streamPhoto") << "photo queue full, request dropped";
+    }
 }
 
+// called on photoQueue's worker thread
+void ofApp::onPhotoSaved(PhotoQueue::Photo& photo) {
+    createResultHtml(photo.fileName);
+
+    //string msg = "{\"unique_id\":" + sessionId + ",\"hostname\":" + hostName + ",\"photo\":" + ofxCrypto::base64_encode(photo.jpeg) + ",\"timestamp\":" + ofToString(photo.timestamp) + "}";
+    string msg = hostName + "," + lastPhotoTakenName;
+    if (sendWs) wsClients.broadcast(ofxHTTP::WebSocketFrame(msg), false);
+}
+
+void ofApp::dumpBurst(PreRollBuffer::Format format) {
+    if (!preRoll) {
+        ofLogWarning("ofApp::dumpBurst") << "pre-roll is off, set <preroll> in settings.xml";
+    } else if (!preRollBuffer.trigger(format)) {
+        ofLogWarning("ofApp::dumpBurst") << "a burst is already being saved, request dropped";
+    }
+}
+
+void ofApp::onBurstDumped(const string& path, int numFrames) {
+    string msg = "{\"unique_id\":\"" + sessionId + "\",\"hostname\":\"" + hostName + "\",\"burst\":\"bursts/" + path + "\",\"frames\":" + ofToString(numFrames) + "}";
+    if (sendWs) wsClients.broadcast(ofxHTTP::WebSocketFrame(msg), false);
+}
+
+void ofApp::onPhotoEncoded(PhotoQueue::Photo& photo) {
+    if (!sendWs) return;
+
+    // a text frame describing the photo, then the jpeg itself as a binary frame
+    string msg = "{\"unique_id\":\"" + sessionId + "\",\"hostname\":\"" + hostName + "\",\"photo_bytes\":" + ofToString(photo.jpeg->size()) + ",\"timestamp\":\"" + ofToString(photo.timestamp) + "\"}";
+    shared_ptr<WsClients::Message> message = make_shared<WsClients::Message>();
+    message->push_back(ofxHTTP::WebSocketFrame(msg));
+    message->push_back(ofxHTTP::WebSocketFrame(*photo.jpeg, Poco::Net::WebSocket::FRAME_BINARY));
+    wsClients.broadcast(message, false); // photos were asked for, never drop them
+}
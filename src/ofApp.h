@@ -2,12 +2,25 @@
 
 #include "ofMain.h"
 #include "ofxCv.h"
-#include "ofxCvPiCam.h"
 #include "ofxOsc.h"
 #include "ofxXmlSettings.h"
 #include "ofxHTTP.h"
 #include "ofxJSONElement.h"
 #include "ofxCrypto.h"
+#include "FrameGrabber.h"
+#include "PiCamSource.h"
+#include "VideoFileSource.h"
+#include "ImageSequenceSource.h"
+#include "RawDumpSource.h"
+#include "VisionPipeline.h"
+#include "BatchSender.h"
+#include "PhotoQueue.h"
+#include "JpegCache.h"
+#include "MjpegServer.h"
+#include "WsClients.h"
+#include "Metrics.h"
+#include "MetricsRoute.h"
+#include "PreRollBuffer.h"
 
 #define NUM_MESSAGES 30 // how many past ws messages we want to keep
 
@@ -17,6 +30,7 @@ class ofApp : public ofBaseApp {
 		void setup();
 		void update();
 		void draw();
+		void exit();
 			
 		int width, height, appFramerate, camFramerate;
 		int thumbWidth, thumbHeight;
@@ -25,23 +39,45 @@ class ofApp : public ofBaseApp {
 		int oscPort, streamPort, wsPort, postPort;
 
 		bool debug; // draw to local screen, default true
+		bool headless = false; // no window or GL, set by main from <headless> or --headless
+		std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now(); // set by main, for the startup metrics
+		bool firstFrame = true;
 
 		ofFile file;
 		ofxXmlSettings settings;
 
-		ofFbo fbo;
-		ofPixels pixels;
 		int rpiCamVersion; // 0 for not an RPi cam, 1, 2, or 3
 		string lastPhotoTakenName;
 		int stillCompression;
 		int timestamp;
 		
 		void createResultHtml(string fileName);
+		void sendResult(FrameJob& job);
 		void takePhoto();
 		void streamPhoto();
 		vector<string> photoFiles;
-
-		ofxHTTP::SimpleIPVideoServer streamServer;
+		PhotoQueue photoQueue;
+		void onPhotoSaved(PhotoQueue::Photo& photo);
+		void onPhotoEncoded(PhotoQueue::Photo& photo);
+
+		bool preRoll; // keep the last seconds of frames for dump_burst, default false
+		PreRollBuffer preRollBuffer;
+		PreRollBuffer::Format burstFormat; // images or mjpeg, default images
+		void dumpBurst(PreRollBuffer::Format format);
+		void onBurstDumped(const string& path, int numFrames);
+
+		JpegCache jpegCache;
+		MjpegServer mjpegServer;
+		int streamQuality; // 0 to 100, default 50
+		WsClients wsClients; // per-client queues for batched output, video and photos
+		void sendWsVideoPaced(FrameJob& job);
+
+		float statsInterval; // seconds between metrics updates, default 1, 0 for off
+		float lastStatsTime;
+		void publishStats();
+		bool routeMetrics(const string& path, string& body, string& contentType);
+		MetricsRoute metricsRoute; // /metrics and /metrics.json on the post server
+		int64_t millisSinceLaunch() const;
 
 		ofxHTTP::SimplePostServer postServer;
 		void onHTTPPostEvent(ofxHTTP::PostEventArgs& evt);
@@ -61,21 +97,25 @@ class ofApp : public ofBaseApp {
 		bool sendWs;  // send websockets
 		bool sendHttp;  // serve web control panel
 		bool sendMjpeg;  // send mjpeg stream	
+		bool batchOutput; // one message per frame per analysis, default false
 
 		bool syncVideo;  // send video image over osc
 		bool brightestPixel;  // send brightest pixel
+		int brightestPixelPeaks; // default 1, more finds the top K separated peaks
+		int peakDistance; // default 20, minimum pixels between peaks
 		bool blobs;  // send blob tracking
+		bool blobTracking; // stable blob ids across frames, default false
+		bool changeDetection; // skip analyses and sends on static frames, default false
+		bool loadShedding; // shed low priority work when frames go over budget, default false
 		bool contours; // send contours
 
-		ofBuffer videoBuffer;
-		ofBuffer photoBuffer;
-		ofBuffer contourColorBuffer;
-		ofBuffer contourPointsBuffer;
-
-		ofxCvPiCam cam;
-		cv::Mat frame, frameProcessed;
-		ofImage gray;
-		ofImage grayThumbnail;
+		unique_ptr<FrameSource> source; // the camera, or footage replayed from disk
+		string sourceType; // picam, video, images or raw, default picam
+		FrameGrabber grabber; // grabs from the source on its own thread
+		VisionPipeline pipeline;
+		shared_ptr<const FrameJob> result; // latest finished frame, for drawing
+		ofTexture frameTexture; // debug view of result
+		uint64_t drawnSeq = 0;
 		int syncVideoQuality; // 5 best to 1 worst, default 3 medium
 		bool videoColor;
 
@@ -99,12 +139,13 @@ class ofApp : public ofBaseApp {
 		bool thresholdKeyFast;
 
 		ofxOscSender sender;
+		BatchSender batchSender;
 		
-		ofxCv::ContourFinder contourFinder;
 		float contourThreshold;  // default 127
 		float contourMinAreaRadius; // default 10
 		float contourMaxAreaRadius; // default 150
 		int contourSlices; // default 20
+		int contourThreads; // default 3, cores to spread the slices across
 		float simplify;
 		int smooth;
 			
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+// Just enough of a test framework: a failed check prints where it was and carries on,
+// and main() returns non-zero if any failed.
+
+extern int checksFailed;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            checksFailed++; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+    do { \
+        auto checkActual = (actual); \
+        auto checkExpected = (expected); \
+        if (!(checkActual == checkExpected)) { \
+            checksFailed++; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is " << +checkActual << ", expected " << +checkExpected << std::endl; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double checkActual = (actual); \
+        double checkExpected = (expected); \
+        if (std::fabs(checkActual - checkExpected) > (tolerance)) { \
+            checksFailed++; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is " << checkActual << ", expected " << checkExpected << std::endl; \
+        } \
+    } while (0)
@@ -0,0 +1,86 @@
+#include "Check.h"
+#include "PeakFinder.h"
+
+#include <random>
+#include <vector>
+
+// The SIMD paths against the *Scalar references over random frames: gray and RGB,
+// odd widths that leave a tail after the last full vector, and padded strides.
+
+static void checkSamePeak(const PeakFinder::Peak& simd, const PeakFinder::Peak& scalar) {
+    CHECK_EQUAL(simd.x, scalar.x);
+    CHECK_EQUAL(simd.y, scalar.y);
+    CHECK_EQUAL(simd.value, scalar.value);
+    CHECK_EQUAL(simd.cx, scalar.cx);
+    CHECK_EQUAL(simd.cy, scalar.cy);
+}
+
+static void testRowMax(std::mt19937& random) {
+    std::vector<uint8_t> row(200);
+    for (int offset = 0; offset < 4; offset++) { // unaligned starts too
+        for (int n = 0; n + offset <= (int) row.size(); n++) {
+            for (auto& v : row) v = random() % 200;
+            if (n > 0) row[offset + random() % n] = 200 + random() % 56; // somewhere, possibly in the tail
+            CHECK_EQUAL(PeakFinder::rowMax(row.data() + offset, n), PeakFinder::rowMaxScalar(row.data() + offset, n));
+        }
+    }
+}
+
+// a dim noise floor with a few bright spots, so the row skipping and the peak tests both get exercised
+static void fillFrame(std::mt19937& random, std::vector<uint8_t>& frame, int width, int height, int channels, int stride, int floor) {
+    frame.assign(stride * height, 0);
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = frame.data() + y * stride;
+        for (int x = 0; x < width * channels; x++) row[x] = random() % floor;
+        for (int x = width * channels; x < stride; x++) row[x] = 255; // padding must never be read as pixels
+    }
+
+    int spots = random() % 6;
+    for (int i = 0; i < spots; i++) {
+        int x = random() % width;
+        int y = random() % height;
+        uint8_t* p = frame.data() + y * stride + x * channels;
+        for (int c = 0; c < channels; c++) p[c] = floor + random() % (256 - floor);
+    }
+}
+
+static void testFrames(std::mt19937& random) {
+    const int widths[] = { 1, 7, 15, 17, 31, 33, 63, 65, 101, 639 };
+    const int channelCounts[] = { 1, 3 };
+
+    PeakFinder finder;
+    std::vector<uint8_t> frame;
+    std::vector<PeakFinder::Peak> simdPeaks;
+    std::vector<PeakFinder::Peak> scalarPeaks;
+
+    for (int width : widths) {
+        for (int channels : channelCounts) {
+            for (int trial = 0; trial < 20; trial++) {
+                int height = 1 + random() % 40;
+                int stride = width * channels + random() % 37;
+                int floor = 1 + random() % 200;
+                int threshold = random() % 256;
+                fillFrame(random, frame, width, height, channels, stride, floor);
+
+                PeakFinder::Peak simd, scalar;
+                bool foundSimd = PeakFinder::findBrightest(frame.data(), width, height, channels, stride, threshold, simd);
+                bool foundScalar = PeakFinder::findBrightestScalar(frame.data(), width, height, channels, stride, threshold, scalar);
+                CHECK_EQUAL(foundSimd, foundScalar);
+                if (foundSimd && foundScalar) checkSamePeak(simd, scalar);
+
+                int k = 1 + random() % 8;
+                int minDistance = random() % 6;
+                int numSimd = finder.findPeaks(frame.data(), width, height, channels, stride, threshold, k, minDistance, simdPeaks);
+                int numScalar = finder.findPeaksScalar(frame.data(), width, height, channels, stride, threshold, k, minDistance, scalarPeaks);
+                CHECK_EQUAL(numSimd, numScalar);
+                for (int i = 0; i < numSimd && i < numScalar; i++) checkSamePeak(simdPeaks[i], scalarPeaks[i]);
+            }
+        }
+    }
+}
+
+void runPeakFinderTests() {
+    std::mt19937 random(1234); // fixed, so a failure can be reproduced
+    testRowMax(random);
+    testFrames(random);
+}
@@ -0,0 +1,262 @@
+#include "Check.h"
+#include "WireFormat.h"
+#include "WireDecoder.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Round trips through WireEncoder and WireDecoder.h, and the fixture packets that
+// wire_fixture.js decodes with DocumentRoot/js/wire.js, so both readers agree with the writer.
+
+// past 32 bits but exact as a JavaScript number
+#define FIXTURE_SEQ ((uint64_t(1) << 40) + 7)
+#define FIXTURE_TIMESTAMP int64_t(1700000000123)
+
+// every value a multiple of 1 / 16, so the default 4 fractional bits hold them exactly
+static void encodeFixtureBlobs(WireEncoder& encoder) {
+    encoder.begin(WireEncoder::BLOBS);
+    encoder.addBlob(0, 12.5f, 3.25f, 4.0f);
+    encoder.addBlob(1, 640.0f, 480.0f, 0.0f);
+    encoder.addBlob(300, -2.0f, 0.0625f, 100.5f);
+}
+
+static void encodeFixtureContours(WireEncoder& encoder) {
+    encoder.begin(WireEncoder::CONTOURS);
+    encoder.beginContour(255, 128, 0, 200, 4);
+    encoder.addContourPoint(10.0f, 10.0f);
+    encoder.addContourPoint(20.5f, 10.0f);
+    encoder.addContourPoint(20.5f, 30.25f);
+    encoder.addContourPoint(10.0f, 30.25f);
+    encoder.beginContour(1, 2, 3, 4, 1);
+    encoder.addContourPoint(0.0f, 0.0f);
+}
+
+static void encodeFixturePixels(WireEncoder& encoder) {
+    encoder.begin(WireEncoder::PIXELS);
+    encoder.addPixel(319.5f, 239.75f, 255);
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static void testVarints() {
+    const uint64_t values[] = { 0, 1, 127, 128, 16383, 16384, 0xffffffffull, 0x100000000ull, 0xffffffffffffffffull };
+    for (uint64_t value : values) {
+        std::vector<uint8_t> bytes;
+        WireEncoder::putVarint(bytes, value);
+        WireReader in(bytes.data(), bytes.size());
+        CHECK_EQUAL(in.varint(), value);
+        CHECK(in.ok());
+    }
+
+    const int64_t signedValues[] = { 0, 1, -1, 63, -64, 64, INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+    for (int64_t value : signedValues) {
+        std::vector<uint8_t> bytes;
+        WireEncoder::putSvarint(bytes, value);
+        WireReader in(bytes.data(), bytes.size());
+        CHECK_EQUAL(in.svarint(), value);
+        CHECK(in.ok());
+    }
+}
+
+static void testBlobs() {
+    WireEncoder encoder;
+    encodeFixtureBlobs(encoder);
+    std::vector<uint8_t> bytes;
+    encoder.writePacket(bytes, FIXTURE_SEQ, FIXTURE_TIMESTAMP);
+
+    WirePacket packet;
+    CHECK(decodeWirePacket(bytes.data(), bytes.size(), packet));
+    CHECK_EQUAL(packet.version, 1);
+    CHECK_EQUAL(packet.type, 1);
+    CHECK_EQUAL(packet.seq, FIXTURE_SEQ);
+    CHECK_EQUAL(packet.timestamp, FIXTURE_TIMESTAMP);
+    CHECK_EQUAL(packet.total, 3);
+    CHECK_EQUAL(packet.part, 0);
+    CHECK_EQUAL(packet.parts, 1);
+    CHECK_EQUAL(packet.blobs.size(), size_t(3));
+    CHECK_EQUAL(packet.blobs[0].x, 12.5f);
+    CHECK_EQUAL(packet.blobs[0].y, 3.25f);
+    CHECK_EQUAL(packet.blobs[0].radius, 4.0f);
+    CHECK_EQUAL(packet.blobs[1].x, 640.0f);
+    CHECK_EQUAL(packet.blobs[2].index, 300);
+    CHECK_EQUAL(packet.blobs[2].x, -2.0f);
+    CHECK_EQUAL(packet.blobs[2].y, 0.0625f);
+    CHECK_EQUAL(packet.blobs[2].radius, 100.5f);
+}
+
+static void testContours() {
+    WireEncoder encoder;
+    encodeFixtureContours(encoder);
+    std::vector<uint8_t> bytes;
+    encoder.writePacket(bytes, 42, -5);
+
+    WirePacket packet;
+    CHECK(decodeWirePacket(bytes.data(), bytes.size(), packet));
+    CHECK_EQUAL(packet.timestamp, int64_t(-5));
+    CHECK_EQUAL(packet.contours.size(), size_t(2));
+    const WireContour& square = packet.contours[0];
+    CHECK_EQUAL(square.r, 255);
+    CHECK_EQUAL(square.g, 128);
+    CHECK_EQUAL(square.b, 0);
+    CHECK_EQUAL(square.brightness, 200);
+    const float expected[] = { 10.0f, 10.0f, 20.5f, 10.0f, 20.5f, 30.25f, 10.0f, 30.25f };
+    CHECK_EQUAL(square.points.size(), size_t(8));
+    for (size_t i = 0; i < square.points.size() && i < 8; i++) CHECK_EQUAL(square.points[i], expected[i]);
+    CHECK_EQUAL(packet.contours[1].points.size(), size_t(2));
+}
+
+// coordinates that don't fit the fixed point grid are rounded once, not accumulated along the deltas
+static void testQuantizationDoesNotDrift() {
+    WireEncoder encoder;
+    encoder.begin(WireEncoder::CONTOURS);
+    const int numPoints = 1000;
+    encoder.beginContour(0, 0, 0, 0, numPoints);
+    for (int i = 0; i < numPoints; i++) encoder.addContourPoint(i * 0.3f, i * 0.7f);
+    std::vector<uint8_t> bytes;
+    encoder.writePacket(bytes, 1, 1);
+
+    WirePacket packet;
+    CHECK(decodeWirePacket(bytes.data(), bytes.size(), packet));
+    CHECK_EQUAL(packet.contours.size(), size_t(1));
+    const std::vector<float>& points = packet.contours[0].points;
+    CHECK_EQUAL(points.size(), size_t(numPoints * 2));
+    for (int i = 0; i < numPoints && i * 2 + 1 < (int) points.size(); i++) {
+        CHECK_NEAR(points[i * 2], i * 0.3f, 1.0f / 32);
+        CHECK_NEAR(points[i * 2 + 1], i * 0.7f, 1.0f / 32);
+    }
+}
+
+// the parts of a split frame hold every item once, in order, and each fits the budget
+static void testSplit() {
+    WireEncoder encoder;
+    encoder.begin(WireEncoder::BLOBS);
+    const int numBlobs = 500;
+    for (int i = 0; i < numBlobs; i++) encoder.addBlob(i, i * 1.5f, i * 2.5f, 3.0f);
+
+    const size_t maxRecordBytes = 200;
+    std::vector<int> partStarts;
+    int parts = encoder.split(maxRecordBytes, partStarts);
+    CHECK(parts > 1);
+    CHECK_EQUAL((int) partStarts.size(), parts);
+
+    int next = 0;
+    std::vector<uint8_t> bytes;
+    for (int part = 0; part < parts; part++) {
+        int first = partStarts[part];
+        int last = part + 1 < parts ? partStarts[part + 1] : encoder.getCount();
+        encoder.writePacket(bytes, FIXTURE_SEQ, FIXTURE_TIMESTAMP, part, parts, first, last);
+
+        WirePacket packet;
+        CHECK(decodeWirePacket(bytes.data(), bytes.size(), packet));
+        CHECK_EQUAL(packet.total, numBlobs);
+        CHECK_EQUAL(packet.part, part);
+        CHECK_EQUAL(packet.parts, parts);
+        CHECK_EQUAL(packet.seq, FIXTURE_SEQ);
+        CHECK(packet.blobs.size() > 0);
+        for (auto& blob : packet.blobs) {
+            CHECK_EQUAL(blob.index, next);
+            CHECK_EQUAL(blob.x, next * 1.5f);
+            next++;
+        }
+    }
+    CHECK_EQUAL(next, numBlobs);
+
+    // one item bigger than the budget gets a part of its own
+    encoder.begin(WireEncoder::CONTOURS);
+    encoder.beginContour(0, 0, 0, 0, 1);
+    encoder.addContourPoint(1, 1);
+    encoder.beginContour(0, 0, 0, 0, 200);
+    for (int i = 0; i < 200; i++) encoder.addContourPoint(i * 10.0f, 0);
+    encoder.beginContour(0, 0, 0, 0, 1);
+    encoder.addContourPoint(2, 2);
+    CHECK_EQUAL(encoder.split(64, partStarts), 3);
+}
+
+// every proper prefix of a packet is rejected rather than read past its end
+static void testTruncated() {
+    WireEncoder encoder;
+    encodeFixtureContours(encoder);
+    std::vector<uint8_t> bytes;
+    encoder.writePacket(bytes, FIXTURE_SEQ, FIXTURE_TIMESTAMP);
+
+    WirePacket packet;
+    for (size_t size = 0; size < bytes.size(); size++) {
+        std::vector<uint8_t> prefix(bytes.begin(), bytes.begin() + size); // its own allocation, so ASan sees overreads
+        CHECK(!decodeWirePacket(prefix.data(), prefix.size(), packet));
+    }
+
+    // foreign magic and unknown versions
+    std::vector<uint8_t> foreign = bytes;
+    foreign[0] = 'X';
+    CHECK(!decodeWirePacket(foreign.data(), foreign.size(), packet));
+    foreign = bytes;
+    foreign[2] = 2;
+    CHECK(!decodeWirePacket(foreign.data(), foreign.size(), packet));
+
+    // fractional bits past the encoder's limit, which would otherwise be shifted by 31 or more
+    const uint8_t fracBits[] = { 25, 31, 32, 255 };
+    for (uint8_t bits : fracBits) {
+        foreign = bytes;
+        foreign[4] = bits;
+        CHECK(!decodeWirePacket(foreign.data(), foreign.size(), packet));
+    }
+    foreign = bytes;
+    foreign[4] = WireEncoder::MAX_FRAC_BITS;
+    CHECK(decodeWirePacket(foreign.data(), foreign.size(), packet));
+
+    // a point count far beyond the packet
+    std::vector<uint8_t> huge;
+    for (int i = 0; i < 5; i++) huge.push_back(bytes[i]);
+    WireEncoder::putVarint(huge, 1);
+    WireEncoder::putSvarint(huge, 1);
+    WireEncoder::putVarint(huge, 1);
+    WireEncoder::putVarint(huge, 0);
+    WireEncoder::putVarint(huge, 1);
+    WireEncoder::putVarint(huge, 1);
+    for (int i = 0; i < 4; i++) huge.push_back(0);
+    WireEncoder::putVarint(huge, uint64_t(1) << 60);
+    CHECK(!decodeWirePacket(huge.data(), huge.size(), packet));
+}
+
+// the committed fixtures are what the encoder writes today; wire_fixture.js checks wire.js reads them
+static void testFixtures(const std::string& dir, bool write) {
+    struct Fixture {
+        const char* name;
+        void (*encode)(WireEncoder&);
+    };
+    const Fixture fixtures[] = {
+        { "blobs.bin", encodeFixtureBlobs },
+        { "contours.bin", encodeFixtureContours },
+        { "pixels.bin", encodeFixturePixels }
+    };
+
+    for (auto& fixture : fixtures) {
+        WireEncoder encoder;
+        fixture.encode(encoder);
+        std::vector<uint8_t> bytes;
+        encoder.writePacket(bytes, FIXTURE_SEQ, FIXTURE_TIMESTAMP);
+
+        std::string path = dir + "/" + fixture.name;
+        if (write) writeFile(path, bytes);
+        CHECK(readFile(path) == bytes);
+    }
+}
+
+void runWireTests(const std::string& fixtureDir, bool writeFixtures) {
+    testVarints();
+    testBlobs();
+    testContours();
+    testQuantizationDoesNotDrift();
+    testSplit();
+    testTruncated();
+    testFixtures(fixtureDir, writeFixtures);
+}
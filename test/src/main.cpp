@@ -0,0 +1,30 @@
+#include "Check.h"
+#include "PeakFinder.h"
+
+#include <cstring>
+#include <string>
+
+int checksFailed = 0;
+
+void runWireTests(const std::string& fixtureDir, bool writeFixtures);
+void runPeakFinderTests();
+
+// tests [--fixtures dir] [--write-fixtures]
+int main(int argc, char* argv[]) {
+    std::string fixtureDir = "fixtures";
+    bool writeFixtures = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fixtures") == 0 && i + 1 < argc) fixtureDir = argv[++i];
+        else if (strcmp(argv[i], "--write-fixtures") == 0) writeFixtures = true;
+    }
+
+    runWireTests(fixtureDir, writeFixtures);
+    runPeakFinderTests();
+
+    if (checksFailed > 0) {
+        std::cerr << checksFailed << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed (" << PeakFinder::getKernelName() << " kernel)" << std::endl;
+    return 0;
+}
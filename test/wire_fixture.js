@@ -0,0 +1,64 @@
+"use strict";
+
+// Decodes the fixture packets written by src/WireTest.cpp with the browser's reader,
+// bin/data/DocumentRoot/js/wire.js. Run by the Makefile: node wire_fixture.js [fixture dir]
+
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+var wire = {};
+vm.runInNewContext(fs.readFileSync(path.join(__dirname, "../bin/data/DocumentRoot/js/wire.js"), "utf8"), wire);
+
+var fixtureDir = process.argv[2] || path.join(__dirname, "fixtures");
+var failed = 0;
+
+function check(name, actual, expected) {
+    if (JSON.stringify(actual) !== JSON.stringify(expected)) {
+        failed++;
+        console.error(name + " is " + JSON.stringify(actual) + ", expected " + JSON.stringify(expected));
+    }
+}
+
+function decode(fileName) {
+    var bytes = fs.readFileSync(path.join(fixtureDir, fileName));
+    return wire.decodeWirePacket(bytes.buffer.slice(bytes.byteOffset, bytes.byteOffset + bytes.length));
+}
+
+// same values as the fixtures in src/WireTest.cpp
+var SEQ = Math.pow(2, 40) + 7;
+var TIMESTAMP = 1700000000123;
+
+var blobs = decode("blobs.bin");
+check("blobs header", [blobs.version, blobs.type, blobs.seq, blobs.timestamp, blobs.total, blobs.part, blobs.parts], [1, 1, SEQ, TIMESTAMP, 3, 0, 1]);
+check("blobs", blobs.blobs, [
+    { index: 0, x: 12.5, y: 3.25, radius: 4 },
+    { index: 1, x: 640, y: 480, radius: 0 },
+    { index: 300, x: -2, y: 0.0625, radius: 100.5 }
+]);
+
+var contours = decode("contours.bin");
+check("contours header", [contours.type, contours.seq, contours.timestamp, contours.total], [2, SEQ, TIMESTAMP, 2]);
+check("contours", contours.contours, [
+    { color: [255, 128, 0], brightness: 200, points: [10, 10, 20.5, 10, 20.5, 30.25, 10, 30.25] },
+    { color: [1, 2, 3], brightness: 4, points: [0, 0] }
+]);
+
+var pixels = decode("pixels.bin");
+check("pixels header", [pixels.type, pixels.seq, pixels.timestamp, pixels.total], [3, SEQ, TIMESTAMP, 1]);
+check("pixels", pixels.pixels, [{ x: 319.5, y: 239.75, brightness: 255 }]);
+
+// a truncated packet is rejected, not half read
+var bytes = fs.readFileSync(path.join(fixtureDir, "contours.bin"));
+check("truncated", wire.decodeWirePacket(bytes.buffer.slice(bytes.byteOffset, bytes.byteOffset + bytes.length - 1)), null);
+
+// so is one with more fractional bits than the encoder writes
+var foreign = Buffer.from(bytes);
+foreign[4] = 32;
+check("fracBits", wire.decodeWirePacket(foreign.buffer.slice(foreign.byteOffset, foreign.byteOffset + foreign.length)), null);
+
+if (failed > 0) {
+    console.error(failed + " wire.js checks failed");
+    process.exit(1);
+}
+console.log("wire.js decodes the fixtures");